@@ -1,15 +1,28 @@
 #include <opencv4/opencv2/opencv.hpp>
 #include <iostream>
+#include <cctype>
 #include <cmath>
 #include <chrono>
 #include <filesystem>
 #include <string>
 
 #include "mylib/hsl.hpp"
+#include "mylib/selective_color.hpp"
+#include "mylib/frame_pipeline.hpp"
+#include "mylib/raw_pipe.hpp"
+#include "mylib/temporal_analyzer.hpp"
+#include "mylib/delta_processor.hpp"
+#include "mylib/job_scheduler.hpp"
+#include "mylib/presets.hpp"
+#include "mylib/image_ops.hpp"
+#include "mylib/alloc_counter.hpp"
+#include "mylib/metrics.hpp"
+#include "mylib/trace.hpp"
 
 using namespace cv;
 
 void process_video(const std::string& input_path, const std::string& output_path, double hue, double saturation, double lightness) {
+    CCM_TRACE_SCOPE("process_video");
     cv::VideoCapture cap(input_path);
     if (!cap.isOpened()) {
         std::cerr << "Error: Could not open the video file." << std::endl;
@@ -22,21 +35,157 @@ void process_video(const std::string& input_path, const std::string& output_path
 
     cv::VideoWriter writer(output_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, cv::Size(frame_width, frame_height));
 
-    cv::Mat frame;
-    while (cap.read(frame)) {
-        cv::Mat adjusted_yello2frame = adjust_hsl_yellow_frame(frame, hue, saturation, lightness);
-        cv::Mat adjusted_frame = adjust_hsl_green_frame(adjusted_yello2frame, hue, saturation, lightness);
-        writer.write(adjusted_frame);
-    }
+    // Yellow (all hues) and green (60-180) bands fused into one pass.
+    SelectiveColor selective({HueBand{0, 360, 0, hue, saturation, lightness},
+                              HueBand{60, 180, 0, hue, saturation, lightness}});
+
+    PipelineOptions options;
+    options.frameSize = cv::Size(frame_width, frame_height);
+    PipelineStats stats = runFramePipeline(
+        [&](cv::Mat& frame) {
+            CCM_TRACE_SCOPE("cap.read");
+            return cap.read(frame);
+        },
+        [&](const cv::Mat& frame, cv::Mat& adjusted_frame) { selective.apply(frame, adjusted_frame); },
+        [&](const cv::Mat& adjusted_frame) {
+            CCM_TRACE_SCOPE("VideoWriter::write");
+            writer.write(adjusted_frame);
+        },
+        options);
+    printPipelineStats(std::cout, stats);
 
     cap.release();
     writer.release();
+    countFileBytes(input_path, output_path);
 
     std::cout << "Processed video saved at: " << output_path << std::endl;
 }
 
 
-int main() {
+int main(int argc, const char * argv[]) {
+    enableMatAllocationCounter();
+    // --pipe-in <y4m|bgr24> [--pipe-out <y4m|bgr24>] [--size WxH] [--fps r]
+    //     filter raw frames from stdin to stdout (logs go to stderr)
+    // --auto [n]  white balance + auto-HSL from temporally smoothed statistics,
+    //             measured every n frames (default 10) instead of the fixed bands
+    // --delta [n] static camera: re-process only changed blocks, full refresh
+    //             every n frames (default 120)
+    // --batch <dir|manifest> [--batch-out dir] [--jobs n] [--memory MB]
+    //     every .mp4 in dir (or listed in the manifest) on one shared worker pool
+    // --preset <name> [--presets file]  hue bands of a scene preset (ref/presets.yml)
+    RawPipeOptions pipe;
+    std::string presetsFile = "ref/presets.yml", presetName;
+    std::string batchInput, batchOutput = "result_hsl_video";
+    SchedulerOptions schedulerOptions;
+    bool autoAdjust = false, useDelta = false;
+    TemporalAnalyzerOptions analyzerOptions;
+    DeltaOptions deltaOptions;
+    for (int i = 1; i < argc; i++) {
+        if (parseRawPipeArgument(argc, argv, i, pipe))
+            continue;
+        if (std::string(argv[i]) == "--auto") {
+            autoAdjust = true;
+            if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                analyzerOptions.analyzeEvery = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--delta") {
+            useDelta = true;
+            if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                deltaOptions.refreshEvery = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--batch" && i + 1 < argc) {
+            batchInput = argv[++i];
+        } else if (std::string(argv[i]) == "--batch-out" && i + 1 < argc) {
+            batchOutput = argv[++i];
+        } else if (std::string(argv[i]) == "--jobs" && i + 1 < argc) {
+            schedulerOptions.threads = std::stoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--memory" && i + 1 < argc) {
+            schedulerOptions.memoryBudget = std::stoul(argv[++i]) << 20;
+        } else if (std::string(argv[i]) == "--preset" && i + 1 < argc) {
+            presetName = argv[++i];
+        } else if (std::string(argv[i]) == "--presets" && i + 1 < argc) {
+            presetsFile = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+    if (pipe.enabled)
+        reserveStdoutForFrames();
+    // CCM_METRICS_FILE=<path>|- : periodic Prometheus file / stdout line protocol
+    auto metricsFlusher = MetricsFlusher::fromEnvironment();
+
+    SelectiveColor selective({HueBand{0, 360, 0, 0, -40, 30},      // vang
+                              HueBand{60, 180, 0, 20, 40, -5}});   // xanh la
+    if (!presetName.empty()) {
+        ScenePreset preset;
+        if (!loadPreset(presetsFile, presetName, preset))
+            return -1;
+        selective = SelectiveColor(preset.bands);
+    }
+    // Auto mode: balance first, then the HSL offsets, both derived from the input frame.
+    TemporalAnalyzer analyzer(analyzerOptions);
+    VideoAdjustments active;
+    SelectiveColor autoBand({HueBand{0, 360, 0, 0, 0, 0}});
+    // The pixel chain itself; pointwise, so the delta processor can run it on blocks.
+    FrameOp chain = [&](const cv::Mat& frame, cv::Mat& adjusted_frame) {
+        if (!autoAdjust) {
+            selective.apply(frame, adjusted_frame);
+            return;
+        }
+        adjustWhiteBalance(frame, adjusted_frame, active.labShift);
+        autoBand.apply(adjusted_frame, adjusted_frame);
+    };
+    DeltaProcessor delta(chain, deltaOptions);
+    FrameOp adjust = [&](const cv::Mat& frame, cv::Mat& adjusted_frame) {
+        if (autoAdjust) {
+            // Statistics always see the whole frame; new adjustments invalidate every block.
+            const VideoAdjustments& target = analyzer.update(frame);
+            const bool hslChanged = target.hue != active.hue || target.saturation != active.saturation ||
+                                    target.lightness != active.lightness;
+            if (hslChanged)
+                autoBand = SelectiveColor({HueBand{0, 360, 0, double(target.hue), double(target.saturation), double(target.lightness)}});
+            if (hslChanged || target.labShift != active.labShift)
+                delta.invalidate();
+            active = target;
+        }
+        if (useDelta)
+            delta.process(frame, adjusted_frame);
+        else
+            chain(frame, adjusted_frame);
+    };
+    auto reportAuto = [&] {
+        if (autoAdjust)
+            std::cout << "Auto: " << analyzer.analyses() << " analyses over " << analyzer.frames() << " frames, "
+                      << analyzer.sceneCuts() << " scene cuts" << std::endl;
+        if (useDelta)
+            std::cout << "Delta: " << delta.processedFraction() * 100 << "% of blocks processed over "
+                      << delta.frames() << " frames, " << delta.refreshes() << " full refreshes" << std::endl;
+    };
+
+    if (!batchInput.empty()) {
+        // Frames of one video are corrected out of order, so only the stateless bands apply.
+        if (autoAdjust || useDelta || pipe.enabled) {
+            std::cerr << "--batch cannot be combined with --auto, --delta or --pipe-in" << std::endl;
+            return -1;
+        }
+        std::vector<BatchItem> jobs;
+        if (std::filesystem::is_directory(batchInput))
+            jobs = collectImages(batchInput, batchOutput, {".mp4"});
+        else if (!readVideoManifest(batchInput, batchOutput, jobs))
+            return -1;
+        std::filesystem::create_directories(batchOutput);
+        SchedulerSummary summary = runVideoJobs(jobs, [&](const cv::Mat& frame, cv::Mat& adjusted_frame) {
+            selective.apply(frame, adjusted_frame);
+        }, schedulerOptions);
+        printSchedulerSummary(std::cout, summary);
+        return summary.failed == 0 ? 0 : -1;
+    }
+
+    if (pipe.enabled) {
+        bool ok = runRawPipe(pipe, adjust);
+        reportAuto();
+        return ok ? 0 : -1;
+    }
+
     std::string input_path = "original_videos/am_vang/28.mp4";
     std::string output_path = "result_hsl_video/am_vang/28.mp4";
 
@@ -54,15 +203,25 @@ int main() {
 
     cv::VideoWriter writer(output_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, cv::Size(frame_width, frame_height));
 
-    cv::Mat frame;
-    while (cap.read(frame)) {
-        cv::Mat adjusted_yello2frame = adjust_hsl_yellow_frame(frame, 0, -40, 30);
-        cv::Mat adjusted_frame = adjust_hsl_green_frame(adjusted_yello2frame, 20, 40, -5);
-        writer.write(adjusted_frame);
-    }
+    PipelineOptions options;
+    options.frameSize = cv::Size(frame_width, frame_height);
+    PipelineStats stats = runFramePipeline(
+        [&](cv::Mat& frame) {
+            CCM_TRACE_SCOPE("cap.read");
+            return cap.read(frame);
+        },
+        adjust,
+        [&](const cv::Mat& adjusted_frame) {
+            CCM_TRACE_SCOPE("VideoWriter::write");
+            writer.write(adjusted_frame);
+        },
+        options);
+    printPipelineStats(std::cout, stats);
+    reportAuto();
 
     cap.release();
     writer.release();
+    countFileBytes(input_path, output_path);
 
     std::cout << "Processed video saved at: " << output_path << std::endl;
 
@@ -73,30 +232,3 @@ int main() {
 
     return 0;
 }
-
-// int main() {
-//     auto start = std::chrono::high_resolution_clock::now();
-
-//     std::string input_folder = "original_videos";
-//     std::string output_folder = "result_hsl_video";
-
-//     std::filesystem::create_directories(output_folder);
-
-//     for (const auto & entry : std::filesystem::directory_iterator(input_folder)) {
-//         if (entry.is_regular_file() && entry.path().extension() == ".mp4") {
-//             std::string input_path = entry.path().string();
-//             std::string file_name = entry.path().filename().string();
-//             std::string output_path = output_folder + "/" + file_name;
-
-//             std::cout << "Processing video: " << file_name << std::endl;
-
-//             process_video(input_path, output_path, 0, -40, 30);
-//         }
-//     }
-
-//     auto end = std::chrono::high_resolution_clock::now();
-//     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-//     std::cout << "Processing time: " << duration.count() << " milliseconds" << std::endl;
-
-//     return 0;
-// }
\ No newline at end of file
@@ -6,104 +6,176 @@
 #include <filesystem>
 #include <string>
 
+#include "mylib/ccm_kernel.hpp"
+#include "mylib/ccm_store.hpp"
+#include "mylib/ccm_online.hpp"
+#include "mylib/param_schedule.hpp"
+#include "mylib/selective_color.hpp"
+#include "mylib/frame_pipeline.hpp"
+#include "mylib/raw_pipe.hpp"
+#include "mylib/alloc_counter.hpp"
+#include "mylib/metrics.hpp"
+#include "mylib/trace.hpp"
+
 using namespace std;
 namespace fs = std::filesystem;
 
-cv::Mat readColorCorrectionMatrix(const std::string& filename) {
-    std::fstream CMC(filename, std::ios::in);
-    
-    if (!CMC) {
-        std::cerr << "Error opening the file: " << filename << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    
-    cv::Mat ColorMatrix(3, 3, CV_32FC1, cv::Scalar(0));
-    
-    std::string textline;
-    int i = 0;
-    while (getline(CMC, textline)) {
-        std::string::size_type pos = 0, prev_pos = 0;
-        float *CMCPtr = ColorMatrix.ptr<float>(i);
-        int j = 0;
-        while ((pos = textline.find_first_of(',', pos)) != std::string::npos) {
-            CMCPtr[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-            prev_pos = ++pos;
-        }
-        i++;
-    }
-    CMC.close();
-    
-    return ColorMatrix;
-}
-
-cv::Mat applyColorCorrection(const cv::Mat& img, const cv::Mat& ColorMatrix, double zoom_factor) {
-    cv::Mat Dst = img.clone();
-    int channels = img.channels();
-    int ImgHeight = img.rows, ImgWidth = img.cols;
-
-    const float *CMC_1 = ColorMatrix.ptr<float>(0);
-    const float *CMC_2 = ColorMatrix.ptr<float>(1);
-    const float *CMC_3 = ColorMatrix.ptr<float>(2);
-    
-    // Điều chỉnh hiệu ứng CCM dựa trên zoom_factor
-    double enhancement = std::min(zoom_factor - 1.0, 1.0);  // Giới hạn tăng cường
-    
-    for (int i = 0; i < ImgHeight; ++i) {
-        const uchar *SP = img.ptr<uchar>(i);
-        uchar *DP = Dst.ptr<uchar>(i);
-        for (int j = 0; j < ImgWidth*channels; j += 3) {
-            // Áp dụng ma trận CCM
-            double b = SP[j] * CMC_1[0] + SP[j + 1] * CMC_2[0] + SP[j+2] * CMC_3[0];
-            double g = SP[j] * CMC_1[1] + SP[j + 1] * CMC_2[1] + SP[j+2] * CMC_3[1];
-            double r = SP[j] * CMC_1[2] + SP[j + 1] * CMC_2[2] + SP[j+2] * CMC_3[2];
-            
-            // Áp dụng hiệu ứng tăng cường dựa trên zoom_factor
-            DP[j] = cv::saturate_cast<uchar>(SP[j] * (1.0 - enhancement) + b * enhancement);
-            DP[j+1] = cv::saturate_cast<uchar>(SP[j+1] * (1.0 - enhancement) + g * enhancement);
-            DP[j+2] = cv::saturate_cast<uchar>(SP[j+2] * (1.0 - enhancement) + r * enhancement);
+// trackChartEvery > 0: look for the colour chart every N frames and keep refining the
+// CCM from it while the video runs (forgetting: weight kept by older detections).
+// pipe.enabled: frames come from stdin and go to stdout instead of the video files.
+// schedule: keyframed CCM strength, HSL offsets and alpha by frame number; parameters
+// it leaves out keep the zoom_factor strength, no HSL and alpha 0.95.
+void processVideo(const std::string& inputVideo, const std::string& outputVideo, const std::string& cmcFile,
+                  int trackChartEvery = 0, double forgetting = 0.9, const RawPipeOptions& pipe = RawPipeOptions(),
+                  const ParamSchedule& schedule = ParamSchedule()) {
+    CCM_TRACE_SCOPE("processVideo");
+    cv::VideoCapture cap;
+    cv::VideoWriter video;
+    RawFrameReader pipeIn;
+    RawFrameWriter pipeOut;
+    cv::Size frameSize;
+    if (pipe.enabled) {
+        if (!pipeIn.open(pipe) ||
+            !pipeOut.open(pipe.outputSet ? pipe.output : pipe.input, pipeIn.size(), pipeIn.frameRate(), pipeIn.aspect()))
+            return;
+        frameSize = pipeIn.size();
+    } else {
+        cap.open(inputVideo);
+        if (!cap.isOpened()) {
+            std::cerr << "Error opening video file" << std::endl;
+            return;
         }
+        int frame_width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
+        int frame_height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+        int fps = cap.get(cv::CAP_PROP_FPS);
+        frameSize = cv::Size(frame_width, frame_height);
+        video.open(outputVideo, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, frameSize);
     }
-    double alpha = 0.95; // Điều chỉnh giá trị này để thay đổi độ sáng (< 1.0 để giảm, > 1.0 để tăng)
-    Dst.convertTo(Dst, -1, alpha, 0);
-    return Dst;
-}
 
-void processVideo(const std::string& inputVideo, const std::string& outputVideo, const std::string& cmcFile) {
-    cv::VideoCapture cap(inputVideo);
-    if (!cap.isOpened()) {
-        std::cerr << "Error opening video file" << std::endl;
+    // Recalibrating (rewriting cmcFile) while the job runs takes effect from the next frame.
+    CcmStore ccmStore(cmcFile);
+    if (!ccmStore.load())
         return;
-    }
-
-    cv::Mat ColorMatrix = readColorCorrectionMatrix(cmcFile);
+    ccmStore.watch();
 
-    int frame_width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
-    int frame_height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-    int fps = cap.get(cv::CAP_PROP_FPS);
+    std::unique_ptr<OnlineChartCalibrator> calibrator;
+    cv::Mat ReferenceColor;
+    if (trackChartEvery > 0 && readReferenceColors("ref/ReferenceColor.csv", ReferenceColor))
+        calibrator = std::make_unique<OnlineChartCalibrator>(ccmStore, ReferenceColor, forgetting);
+    size_t frameIndex = 0, identityFrames = 0;
+    SelectiveColor hslBand;
+    FrameParams hslParams;   // offsets hslBand was built with
 
-    cv::VideoWriter video(outputVideo, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, cv::Size(frame_width, frame_height));
+    double base_width = frameSize.width;
+    PipelineOptions options;
+    options.frameSize = frameSize;
+    PipelineStats stats;
+    try {
+        stats = runFramePipeline(
+            [&](cv::Mat& frame) {
+                if (pipe.enabled) {
+                    CCM_TRACE_SCOPE("pipe.read");
+                    return pipeIn.read(frame);
+                }
+                CCM_TRACE_SCOPE("cap.read");
+                return cap.read(frame);
+            },
+            [&](const cv::Mat& frame, cv::Mat& corrected) {
+                // Tính toán zoom factor
+                double zoom_factor = static_cast<double>(frame.cols) / base_width;
+                const size_t index = frameIndex++;
+                if (calibrator && index % trackChartEvery == 0)
+                    calibrator->offer(frame);
 
-    cv::Mat frame;
-    double base_width = frame_width;
-    while (cap.read(frame)) {
-        // Tính toán zoom factor
-        double zoom_factor = static_cast<double>(frame.cols) / base_width;
-        
-        cv::Mat corrected = applyColorCorrection(frame, ColorMatrix, zoom_factor);
-        video.write(corrected);
+                // Điều chỉnh hiệu ứng CCM dựa trên zoom_factor, giảm độ sáng 0.95
+                FrameParams defaults;
+                defaults.strength = std::min(zoom_factor - 1.0, 1.0);
+                defaults.alpha = 0.95;
+                const FrameParams p = schedule.at(static_cast<double>(index), defaults);
+                const cv::Mat* src = &frame;
+                if (p.hasHsl()) {
+                    if (p.hue != hslParams.hue || p.saturation != hslParams.saturation || p.lightness != hslParams.lightness) {
+                        hslBand = SelectiveColor({HueBand{0, 360, 0, p.hue, p.saturation, p.lightness}});
+                        hslParams = p;
+                    }
+                    hslBand.apply(frame, corrected);
+                    src = &corrected;
+                }
+                // Composed once per frame; a frame whose matrix is the identity is not touched.
+                const cv::Matx33f M = composeFrameMatrix(ccmStore.current()->matrix, p.strength, p.alpha);
+                if (!isIdentityMatrix(M)) {
+                    applyCCM(*src, corrected, M);
+                } else if (src == &frame) {
+                    identityFrames++;
+                    frame.copyTo(corrected);
+                }
+            },
+            [&](const cv::Mat& corrected) {
+                if (pipe.enabled) {
+                    CCM_TRACE_SCOPE("pipe.write");
+                    pipeOut.write(corrected);
+                    return;
+                }
+                CCM_TRACE_SCOPE("VideoWriter::write");
+                video.write(corrected);
+            },
+            options);
+    } catch (const std::exception& e) {
+        std::cerr << "Processing stopped: " << e.what() << std::endl;
+        return;
     }
+    printPipelineStats(std::cout, stats);
+    if (calibrator)
+        std::cout << "Chart tracking: " << calibrator->detections() << " updates, " << calibrator->misses()
+                  << " frames without a usable chart, CCM v" << ccmStore.current()->version << std::endl;
+    if (!schedule.empty())
+        std::cout << "Schedule: " << identityFrames << " of " << frameIndex << " frames passed through unchanged" << std::endl;
 
+    if (pipe.enabled)
+        return;
     cap.release();
     video.release();
+    countFileBytes(inputVideo, outputVideo);
 }
-int main() {
+int main(int argc, const char * argv[]) {
+    enableMatAllocationCounter();
     auto start = std::chrono::high_resolution_clock::now();
 
     std::string inputVideo = "result_hsl_video/am_vang/28.mp4";
     std::string outputVideo = "result_hsl_ccm/am_vang/28.mp4";
     std::string cmcFile = "ref/LCC_CMC.csv";
 
-    processVideo(inputVideo, outputVideo, cmcFile);
+    // --track-chart <n>   re-estimate the CCM from a chart in view every n frames
+    // --forgetting <f>    per-detection decay of older chart observations (default 0.9)
+    // --pipe-in <y4m|bgr24> [--pipe-out <y4m|bgr24>] [--size WxH] [--fps r]
+    //                     filter raw frames from stdin to stdout (logs go to stderr)
+    // --schedule <file>   keyframed strength/hue/saturation/lightness/alpha (see param_schedule.hpp)
+    int trackChartEvery = 0;
+    double forgetting = 0.9;
+    RawPipeOptions pipe;
+    ParamSchedule schedule;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parseRawPipeArgument(argc, argv, i, pipe))
+            continue;
+        if (arg == "--track-chart" && i + 1 < argc) {
+            trackChartEvery = std::stoi(argv[++i]);
+        } else if (arg == "--forgetting" && i + 1 < argc) {
+            forgetting = std::stod(argv[++i]);
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            if (!readParamSchedule(argv[++i], schedule))
+                return -1;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (pipe.enabled)
+        reserveStdoutForFrames();
+    // CCM_METRICS_FILE=<path>|- : periodic Prometheus file / stdout line protocol
+    auto metricsFlusher = MetricsFlusher::fromEnvironment();
+    processVideo(inputVideo, outputVideo, cmcFile, trackChartEvery, forgetting, pipe, schedule);
 
     std::cout << "Video processing completed." << std::endl;
 
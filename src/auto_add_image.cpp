@@ -3,6 +3,7 @@
 #include <cmath>
 #include <vector>
 #include "hsl.hpp"
+#include "hsl_stats.hpp"
 #include <string>
 
 
@@ -13,64 +14,26 @@ using namespace std;
 
 // Hàm mới để tính toán thống kê HSL của ảnh
 void calculateHSLStats(const Mat& img, vector<double>& meanHSL, vector<double>& stdDevHSL) {
-    vector<double> hValues, sValues, lValues;
-    for (int y = 0; y < img.rows; y++) {
-        for (int x = 0; x < img.cols; x++) {
-            Vec3b pixel = img.at<Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-            hValues.push_back(hsl.h);
-            sValues.push_back(hsl.s);
-            lValues.push_back(hsl.l);
-        }
-    }
-
-    auto calculateMeanStdDev = [](const vector<double>& values) {
-        double sum = accumulate(values.begin(), values.end(), 0.0);
-        double mean = sum / values.size();
-        double sqSum = inner_product(values.begin(), values.end(), values.begin(), 0.0);
-        double stdDev = sqrt(sqSum / values.size() - mean * mean);
-        return make_pair(mean, stdDev);
-    };
-
-    auto [hMean, hStdDev] = calculateMeanStdDev(hValues);
-    auto [sMean, sStdDev] = calculateMeanStdDev(sValues);
-    auto [lMean, lStdDev] = calculateMeanStdDev(lValues);
-
-    meanHSL = {hMean, sMean, lMean};
-    stdDevHSL = {hStdDev, sStdDev, lStdDev};
-}
-
-// Hàm mới để xác định các điều chỉnh HSL dựa trên thống kê
-void determineHSLAdjustments(const vector<double>& meanHSL, const vector<double>& stdDevHSL, 
-                             int& hAdjust, int& sAdjust, int& lAdjust) {
-    // Hue: Thường không điều chỉnh tự động
-    hAdjust = 0;
-
-    // Saturation: Điều chỉnh để đưa về mức trung bình nếu quá cao hoặc quá thấp
-    if (meanHSL[1] < 30) {
-        sAdjust = min(50, int((30 - meanHSL[1]) / 2));
-    } else if (meanHSL[1] > 70) {
-        sAdjust = max(-50, int((70 - meanHSL[1]) / 2));
-    } else {
-        sAdjust = 0;
-    }
-
-    // Lightness: Điều chỉnh để đưa về mức trung bình nếu quá tối hoặc quá sáng
-    if (meanHSL[2] < 40) {
-        lAdjust = min(30, int((40 - meanHSL[2]) / 2));
-    } else if (meanHSL[2] > 60) {
-        lAdjust = max(-30, int((60 - meanHSL[2]) / 2));
-    } else {
-        lAdjust = 0;
+    HslStatsOptions options;
+    options.histograms = false;
+    HslStats stats = computeHslStats(img, options);
+
+    meanHSL.assign(3, 0.0);
+    stdDevHSL.assign(3, 0.0);
+    for (int c = 0; c < 3; c++) {
+        meanHSL[c] = stats.mean(c);
+        stdDevHSL[c] = stats.stddev(c);
     }
 }
 
 Mat autoAdjustHSL(const Mat& img, const string& output_path) {
-    vector<double> meanHSL, stdDevHSL;
-    calculateHSLStats(img, meanHSL, stdDevHSL);
+    // Every other pixel of every other row is plenty for a global decision.
+    HslStatsOptions options;
+    options.sampleStep = 2;
+    HslStats stats = computeHslStats(img, options);
 
     int hAdjust, sAdjust, lAdjust;
-    determineHSLAdjustments(meanHSL, stdDevHSL, hAdjust, sAdjust, lAdjust);
+    determineHSLAdjustments(stats, hAdjust, sAdjust, lAdjust);
 
     cout << "Automatic adjustments: H: " << hAdjust 
          << ", S: " << sAdjust << ", L: " << lAdjust << endl;
@@ -0,0 +1,384 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mylib/hsl.hpp"
+#include "mylib/Linear_CCM.hpp"
+#include "mylib/image_ops.hpp"
+#include "mylib/lut3d.hpp"
+#include "mylib/ccm_model.hpp"
+#include "mylib/hsl_stats.hpp"
+#include "mylib/hsl_simd.hpp"
+#include "mylib/selective_color.hpp"
+#include "mylib/parallel.hpp"
+
+namespace fs = std::filesystem;
+
+// Micro-benchmarks for every per-pixel stage at 720p / 1080p / 4K.
+//
+//   ccm_bench [--out bench.json] [--baseline old.json] [--threshold 0.10]
+//             [--threads 1,8] [--resolutions 720p,1080p,4k] [--sources synthetic,data,imgs]
+//             [--filter name] [--min-time 0.3]
+//
+// Run from the repository root (LCC reads ref/LCC_CMC.csv, real frames come
+// from data/ and imgs/). With --baseline the exit code is 1 when any case is
+// slower (ns/pixel) than the baseline by more than the threshold.
+
+struct BenchCase {
+    std::string name;
+    bool threaded;   // uses the row-band pool; single-threaded cases run once
+    std::function<void(const cv::Mat& src, cv::Mat& dst)> run;
+};
+
+struct BenchResult {
+    std::string name, resolution, source;
+    int threads = 1;
+    int iterations = 0;
+    double ms = 0, mpixPerSecond = 0, nsPerPixel = 0;
+
+    std::string key() const {
+        return name + "|" + resolution + "|" + source + "|" + std::to_string(threads);
+    }
+};
+
+namespace {
+
+// Representative calibration from ref/LCC_CMC.csv; kernel speed does not depend on the values.
+const cv::Matx33f kColorMatrix(2.57554f, -0.214427f, -0.0823024f,
+                               -1.2281f, 2.12997f, 0.0764149f,
+                               -0.435714f, -0.946259f, 0.916388f);
+
+// Higher-order model fitted to kColorMatrix on a 3x3x3 colour grid, for timing only.
+CcmModel benchModel(CcmModelType type) {
+    cv::Mat O(27, 3, CV_32F), R;
+    for (int i = 0; i < 27; i++) {
+        O.at<float>(i, 0) = 20.0f + 100.0f * (i % 3);
+        O.at<float>(i, 1) = 20.0f + 100.0f * (i / 3 % 3);
+        O.at<float>(i, 2) = 20.0f + 100.0f * (i / 9);
+    }
+    R = O * cv::Mat(kColorMatrix);
+    CcmModel model;
+    fitCcmModel(type, O, R, model);
+    return model;
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+cv::Size resolutionSize(const std::string& name) {
+    if (name == "720p") return cv::Size(1280, 720);
+    if (name == "1080p") return cv::Size(1920, 1080);
+    if (name == "4k") return cv::Size(3840, 2160);
+    return cv::Size();
+}
+
+std::string firstImage(const std::string& dir) {
+    std::vector<std::string> files;
+    if (!fs::is_directory(dir))
+        return "";
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string ext = entry.path().extension().string();
+        if (entry.is_regular_file() && (ext == ".jpg" || ext == ".png" || ext == ".bmp"))
+            files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files.empty() ? "" : files.front();
+}
+
+cv::Mat makeFrame(const std::string& source, cv::Size size) {
+    if (source == "synthetic") {
+        // Smooth gradients plus noise: realistic hue spread, fixed seed.
+        cv::Mat frame(size, CV_8UC3);
+        for (int y = 0; y < size.height; y++) {
+            cv::Vec3b* row = frame.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < size.width; x++)
+                row[x] = cv::Vec3b(x * 255 / size.width, y * 255 / size.height, (x + y) * 255 / (size.width + size.height));
+        }
+        cv::Mat noise(size, CV_8UC3);
+        cv::RNG rng(12345);
+        rng.fill(noise, cv::RNG::UNIFORM, 0, 48);
+        cv::add(frame, noise, frame);
+        return frame;
+    }
+
+    std::string path = firstImage(source);
+    cv::Mat img = path.empty() ? cv::Mat() : cv::imread(path, cv::IMREAD_COLOR);
+    if (img.empty())
+        return cv::Mat();
+    cv::Mat frame;
+    cv::resize(img, frame, size, 0, 0, cv::INTER_AREA);
+    return frame;
+}
+
+std::vector<BenchCase> makeCases() {
+    static Lut3D lut = bakeLut3D([](const cv::Vec3f& bgr) {
+        return cv::Vec3f(bgr[0] * 0.9f, bgr[1], bgr[2] * 1.1f);
+    }, 33);
+    static SelectiveColor twoBands({HueBand{0, 360, 0, 0, -40, 30}, HueBand{60, 180, 0, 20, 40, -5}});
+    static cv::Mat matrix(kColorMatrix);
+
+    std::vector<BenchCase> cases = {
+        {"rgb_to_hsl", false, [](const cv::Mat& src, cv::Mat& dst) {
+            double checksum = 0;
+            for (int y = 0; y < src.rows; y++) {
+                const cv::Vec3b* row = src.ptr<cv::Vec3b>(y);
+                for (int x = 0; x < src.cols; x++) {
+                    HSL hsl = rgb_to_hsl(row[x][2], row[x][1], row[x][0]);
+                    checksum += hsl.h + hsl.s + hsl.l;
+                }
+            }
+            dst.create(1, 1, CV_64F);
+            dst.at<double>(0) = checksum;   // keeps the loop alive
+        }},
+        {"hsl_to_rgb", false, [](const cv::Mat& src, cv::Mat& dst) {
+            dst.create(src.size(), src.type());
+            for (int y = 0; y < src.rows; y++) {
+                const cv::Vec3b* SP = src.ptr<cv::Vec3b>(y);
+                cv::Vec3b* DP = dst.ptr<cv::Vec3b>(y);
+                // Treat the input bytes as H/S/L so the conversion itself is measured.
+                for (int x = 0; x < src.cols; x++)
+                    DP[x] = hsl_to_rgb(SP[x][0] * (359.0 / 255.0), SP[x][1] / 2.55, SP[x][2] / 2.55);
+            }
+        }},
+        {"hsl_round_trip_simd", false, [](const cv::Mat& src, cv::Mat& dst) {
+            dst.create(src.size(), src.type());
+            std::vector<float> planes(size_t(src.cols) * 3);
+            float* H = planes.data();
+            for (int y = 0; y < src.rows; y++) {
+                bgrRowToHsl(src.ptr<uchar>(y), H, H + src.cols, H + 2 * src.cols, src.cols);
+                hslRowToBgr(H, H + src.cols, H + 2 * src.cols, dst.ptr<uchar>(y), src.cols);
+            }
+        }},
+        {"computeHslStats", true, [](const cv::Mat& src, cv::Mat& dst) {
+            HslStats stats = computeHslStats(src);
+            dst.create(1, 1, CV_64F);
+            dst.at<double>(0) = stats.mean(1) + stats.percentile(2, 0.5);
+        }},
+        {"adjust_hsl_yellow_frame", true, [](const cv::Mat& src, cv::Mat& dst) {
+            adjust_hsl_yellow_frame(src, dst, 0, -40, 30);
+        }},
+        {"adjust_hsl_green_frame", true, [](const cv::Mat& src, cv::Mat& dst) {
+            adjust_hsl_green_frame(src, dst, 20, 40, -5);
+        }},
+        {"selective_color_2band", true, [](const cv::Mat& src, cv::Mat& dst) {
+            twoBands.apply(src, dst);
+        }},
+        {"LCC", true, [](const cv::Mat& src, cv::Mat& dst) {
+            cv::Mat img = src;
+            LCC(img, dst);
+        }},
+        {"applyColorCorrection", true, [](const cv::Mat& src, cv::Mat& dst) {
+            applyColorCorrection(src, dst, matrix);
+        }},
+        {"applyCcmModel_affine", true, [](const cv::Mat& src, cv::Mat& dst) {
+            static CcmModel model = benchModel(CcmModelType::Affine3x4);
+            applyCcmModel(src, dst, model);
+        }},
+        {"applyCcmModel_poly2", true, [](const cv::Mat& src, cv::Mat& dst) {
+            static CcmModel model = benchModel(CcmModelType::Poly2);
+            applyCcmModel(src, dst, model);
+        }},
+        {"applyCcmModel_poly3", true, [](const cv::Mat& src, cv::Mat& dst) {
+            static CcmModel model = benchModel(CcmModelType::Poly3);
+            applyCcmModel(src, dst, model);
+        }},
+        {"applyCcmModel_rootpoly", true, [](const cv::Mat& src, cv::Mat& dst) {
+            static CcmModel model = benchModel(CcmModelType::RootPoly);
+            applyCcmModel(src, dst, model);
+        }},
+        {"applyLut3D", true, [](const cv::Mat& src, cv::Mat& dst) {
+            applyLut3D(src, dst, lut);
+        }},
+        {"gammaCorrection", true, [](const cv::Mat& src, cv::Mat& dst) {
+            gammaCorrection(src, dst, 1.2f);
+        }},
+        {"adjustWhiteBalance", true, [](const cv::Mat& src, cv::Mat& dst) {
+            adjustWhiteBalance(src, dst);
+        }},
+        {"unsharpMask", true, [](const cv::Mat& src, cv::Mat& dst) {
+            unsharpMask(src, dst, 0.5f);
+        }},
+        {"bilateralFilter", true, [](const cv::Mat& src, cv::Mat& dst) {
+            bilateralFilter(src, dst, 9, 75, 75);
+        }},
+    };
+    return cases;
+}
+
+BenchResult measure(const BenchCase& bench, const cv::Mat& frame, double minSeconds) {
+    using Clock = std::chrono::steady_clock;
+    cv::Mat dst;
+    bench.run(frame, dst);   // warm-up: allocates dst, fills caches and scratch buffers
+
+    std::vector<double> samples;
+    Clock::time_point start = Clock::now();
+    do {
+        Clock::time_point t = Clock::now();
+        bench.run(frame, dst);
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t).count());
+    } while (samples.size() < 3 ||
+             (std::chrono::duration<double>(Clock::now() - start).count() < minSeconds && samples.size() < 1000));
+
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    BenchResult result;
+    result.iterations = static_cast<int>(samples.size());
+    result.ms = samples[samples.size() / 2];
+    double pixels = static_cast<double>(frame.total());
+    result.mpixPerSecond = pixels / (result.ms * 1e3);
+    result.nsPerPixel = result.ms * 1e6 / pixels;
+    return result;
+}
+
+void writeResults(const std::string& path, const std::vector<BenchResult>& results) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_JSON);
+    fs << "results" << "[";
+    for (const BenchResult& r : results) {
+        fs << "{" << "name" << r.name << "resolution" << r.resolution << "source" << r.source
+           << "threads" << r.threads << "iterations" << r.iterations << "ms" << r.ms
+           << "mpix_per_s" << r.mpixPerSecond << "ns_per_pixel" << r.nsPerPixel << "}";
+    }
+    fs << "]";
+}
+
+bool readResults(const std::string& path, std::map<std::string, BenchResult>& results) {
+    cv::FileStorage fs(path, cv::FileStorage::READ | cv::FileStorage::FORMAT_JSON);
+    if (!fs.isOpened()) {
+        std::cerr << "Error opening the baseline file: " << path << std::endl;
+        return false;
+    }
+    for (const cv::FileNode& node : fs["results"]) {
+        BenchResult r;
+        node["name"] >> r.name;
+        node["resolution"] >> r.resolution;
+        node["source"] >> r.source;
+        node["threads"] >> r.threads;
+        node["ms"] >> r.ms;
+        node["mpix_per_s"] >> r.mpixPerSecond;
+        node["ns_per_pixel"] >> r.nsPerPixel;
+        results[r.key()] = r;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, const char * argv[]) {
+    std::string outPath = "bench.json", baselinePath, filter;
+    double threshold = 0.10, minSeconds = 0.3;
+    std::vector<std::string> resolutions = {"720p", "1080p", "4k"};
+    std::vector<std::string> sources = {"synthetic", "data", "imgs"};
+    std::vector<int> threadCounts = {1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselinePath = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            threshold = std::stod(argv[++i]);
+        } else if (arg == "--min-time" && hasValue) {
+            minSeconds = std::stod(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "--resolutions" && hasValue) {
+            resolutions = splitList(argv[++i]);
+        } else if (arg == "--sources" && hasValue) {
+            sources = splitList(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            threadCounts.clear();
+            for (const std::string& t : splitList(argv[++i]))
+                threadCounts.push_back(std::stoi(t));
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+    std::map<std::string, BenchResult> baseline;
+    if (!baselinePath.empty() && !readResults(baselinePath, baseline))
+        return 2;
+
+    std::vector<BenchCase> cases = makeCases();
+    std::vector<BenchResult> results;
+    int regressions = 0;
+
+    std::cout << std::left << std::setw(26) << "case" << std::setw(7) << "res" << std::setw(11) << "source"
+              << std::right << std::setw(4) << "thr" << std::setw(11) << "ms" << std::setw(11) << "MPix/s"
+              << std::setw(10) << "ns/px" << std::setw(10) << "vs base" << std::endl;
+
+    for (const std::string& resolution : resolutions) {
+        cv::Size size = resolutionSize(resolution);
+        if (size.area() == 0) {
+            std::cerr << "Unknown resolution: " << resolution << std::endl;
+            return 2;
+        }
+        for (const std::string& source : sources) {
+            cv::Mat frame = makeFrame(source, size);
+            if (frame.empty()) {
+                std::cerr << "Skipping source without images: " << source << std::endl;
+                continue;
+            }
+            for (const BenchCase& bench : cases) {
+                if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+                    continue;
+                for (int threads : threadCounts) {
+                    if (!bench.threaded && threads != threadCounts.front())
+                        continue;
+                    ParallelConfig config = getParallelConfig();
+                    config.threads = threads;
+                    setParallelConfig(config);
+
+                    BenchResult r = measure(bench, frame, minSeconds);
+                    r.name = bench.name;
+                    r.resolution = resolution;
+                    r.source = source;
+                    r.threads = bench.threaded ? threads : 1;
+                    results.push_back(r);
+
+                    std::cout << std::left << std::setw(26) << r.name << std::setw(7) << r.resolution
+                              << std::setw(11) << r.source << std::right << std::setw(4) << r.threads
+                              << std::fixed << std::setprecision(2) << std::setw(11) << r.ms
+                              << std::setw(11) << r.mpixPerSecond << std::setw(10) << r.nsPerPixel;
+                    auto base = baseline.find(r.key());
+                    if (base != baseline.end() && base->second.nsPerPixel > 0) {
+                        double change = r.nsPerPixel / base->second.nsPerPixel - 1.0;
+                        std::cout << std::showpos << std::setw(9) << change * 100 << "%" << std::noshowpos;
+                        if (change > threshold) {
+                            std::cout << "  REGRESSION";
+                            regressions++;
+                        }
+                    }
+                    std::cout << std::defaultfloat << std::endl;
+                }
+            }
+        }
+    }
+
+    writeResults(outPath, results);
+    std::cout << "Results saved at: " << outPath << std::endl;
+    if (!baseline.empty()) {
+        std::cout << regressions << " regression(s) above " << threshold * 100 << "% vs " << baselinePath << std::endl;
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
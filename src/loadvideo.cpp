@@ -3,6 +3,10 @@
 #include <cmath>
 #include <chrono>
 
+#include "mylib/parallel.hpp"
+#include "mylib/frame_pipeline.hpp"
+#include "mylib/alloc_counter.hpp"
+
 
 using namespace cv;
 struct HSL {
@@ -66,21 +70,28 @@ cv::Vec3b hsl_to_rgb(double h, double s, double l) {
                      static_cast<uchar>((b + m) * 255));
 }
 
-cv::Mat adjust_hsl_frame(const cv::Mat& frame, double hue, double saturation, double lightness) {
-    cv::Mat result = frame.clone();
-    for (int y = 0; y < frame.rows; y++) {
-        for (int x = 0; x < frame.cols; x++) {
-            cv::Vec3b pixel = frame.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-
-            hsl.h = std::fmod(hsl.h + hue, 360.0);
-            hsl.s = std::min(std::max(hsl.s * (1 + saturation / 100), 0.0), 100.0);
-            hsl.l = std::min(std::max(hsl.l * (1 + lightness / 100), 0.0), 100.0);
-
-            cv::Vec3b rgb = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-            result.at<cv::Vec3b>(y, x) = rgb;
+void adjust_hsl_frame(const cv::Mat& frame, cv::Mat& result, double hue, double saturation, double lightness) {
+    result.create(frame.size(), frame.type());
+    parallelRows(frame.rows, [&](int rowStart, int rowEnd) {
+        for (int y = rowStart; y < rowEnd; y++) {
+            const cv::Vec3b* SP = frame.ptr<cv::Vec3b>(y);
+            cv::Vec3b* DP = result.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < frame.cols; x++) {
+                HSL hsl = rgb_to_hsl(SP[x][2], SP[x][1], SP[x][0]);  // OpenCV uses BGR
+
+                hsl.h = std::fmod(hsl.h + hue, 360.0);
+                hsl.s = std::min(std::max(hsl.s * (1 + saturation / 100), 0.0), 100.0);
+                hsl.l = std::min(std::max(hsl.l * (1 + lightness / 100), 0.0), 100.0);
+
+                DP[x] = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
+            }
         }
-    }
+    });
+}
+
+cv::Mat adjust_hsl_frame(const cv::Mat& frame, double hue, double saturation, double lightness) {
+    cv::Mat result;
+    adjust_hsl_frame(frame, result, hue, saturation, lightness);
     return result;
 }
 
@@ -99,17 +110,23 @@ void process_video(const std::string& input_path, const std::string& output_path
 
     cv::VideoWriter writer(output_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps, cv::Size(frame_width, frame_height));
 
-    cv::Mat frame;
-    while (cap.read(frame)) {
-        cv::Mat adjusted_frame = adjust_hsl_frame(frame, hue, saturation, lightness);
-        writer.write(adjusted_frame);
-    }
+    PipelineOptions options;
+    options.frameSize = cv::Size(frame_width, frame_height);
+    PipelineStats stats = runFramePipeline(
+        [&](cv::Mat& frame) { return cap.read(frame); },
+        [&](const cv::Mat& frame, cv::Mat& adjusted_frame) {
+            adjust_hsl_frame(frame, adjusted_frame, hue, saturation, lightness);
+        },
+        [&](const cv::Mat& adjusted_frame) { writer.write(adjusted_frame); },
+        options);
+    printPipelineStats(std::cout, stats);
     cap.release();
     writer.release();
     std::cout << "Processed video saved at: " << output_path << std::endl;
 }
 
 int main() {
+    enableMatAllocationCounter();
     auto start = std::chrono::high_resolution_clock::now();
 
     std::string input_path = "/home/trunglx/Downloads/github/Linear_Color_Correction_Matrix/original_videos/2.mp4";  // Đường dẫn tới video đầu vào
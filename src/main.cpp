@@ -1,14 +1,113 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
 /****************************************************/
+#include <filesystem>
+#include <string>
+#include <vector>
+
 #include "Linear_CCM.hpp"
+#include "mylib/chart_detect.hpp"
+#include "mylib/ccm_kernel.hpp"
+#include "mylib/ccm_model.hpp"
+#include "mylib/ccm_store.hpp"
+#include "mylib/batch_processor.hpp"
 using namespace std;
+namespace fs = std::filesystem;
+
+// Calibrates every chart capture in inputDir independently: writes the corrected
+// image and its own <name>_CMC.csv to outputDir, without any window.
+int calibrateBatch(const std::string& inputDir, const std::string& outputDir, const BatchOptions& options,
+                   CcmModelType modelType) {
+    cv::Mat ReferenceColor;
+    if (!readReferenceColors("ref/ReferenceColor.csv", ReferenceColor))
+        return -1;
+    fs::create_directories(outputDir);
 
+    BatchSummary summary = runImageBatch(collectImages(inputDir, outputDir, {".jpg", ".png", ".bmp"}),
+        [&](const cv::Mat& img, cv::Mat& corrected, const BatchItem& item) {
+            ChartDetection chart = detectColorChart(img, ReferenceColor);
+            if (!chart.found) {
+                std::cerr << "Color chart not found: " << item.input << std::endl;
+                return false;
+            }
+            CcmModel model;
+            if (!fitCcmModel(modelType, chart.patchColors, ReferenceColor, model))
+                return false;
+            fs::path csv = fs::path(outputDir) / (fs::path(item.input).stem().string() + "_CMC.csv");
+            if (!writeCcmModel(csv.string(), model))
+                return false;
+            applyCcmModel(img, corrected, model);
+            return true;
+        }, options);
+    printBatchSummary(std::cout, summary);
+    return summary.failed == 0 ? 0 : 1;
+}
 
 int main(int argc, const char * argv[]) {
-    
-    cv::Mat img = cv::imread("imgs/original_img.bmp",cv::IMREAD_COLOR);
+    // (no arguments)              interactive: drag the 24 patches in the ROI window
+    // --auto [image]              headless: locate the chart, save ref/LCC_CMC.csv and imgs/result.bmp
+    // --batch <inputDir> <outDir> [--jobs n]  one CCM per capture, unattended
+    // --model linear|affine|poly2|poly3|rootpoly  model fitted by --auto / --batch (default linear);
+    //                             --auto saves non-linear models as ref/LCC_CMC_<model>.csv
+    std::vector<std::string> args(argv + 1, argv + argc);
+    CcmModelType modelType = CcmModelType::Linear3x3;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--model") {
+            if (i + 1 == args.size()) {
+                std::cerr << "Missing value for --model" << std::endl;
+                return -1;
+            }
+            if (!parseCcmModelType(args[i + 1], modelType)) {
+                std::cerr << "Unknown model: " << args[i + 1] << std::endl;
+                return -1;
+            }
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            break;
+        }
+    }
+    std::string mode = args.empty() ? "" : args[0];
+    if (mode == "--batch") {
+        if (args.size() < 3) {
+            std::cerr << "Usage: " << argv[0] << " --batch <inputDir> <outputDir> [--jobs n] [--model name]" << std::endl;
+            return -1;
+        }
+        BatchOptions options;
+        for (size_t i = 3; i < args.size(); i++) {
+            if (args[i] == "--jobs" && i + 1 < args.size()) {
+                options.concurrency = std::stoi(args[++i]);
+            } else {
+                std::cerr << "Unknown argument: " << args[i] << std::endl;
+                return -1;
+            }
+        }
+        return calibrateBatch(args[1], args[2], options, modelType);
+    }
+
+    std::string imagePath = "imgs/original_img.bmp";
+    if (mode == "--auto" && args.size() > 1)
+        imagePath = args[1];
+    cv::Mat img = cv::imread(imagePath, cv::IMREAD_COLOR);
+    if (img.empty()) {
+        std::cerr << "Cannot read image: " << imagePath << std::endl;
+        return -1;
+    }
     cv::Mat dst;
+
+    if (mode == "--auto") {
+        if (!LCC_CMC_Auto(img, "./ref/LCC_CMC.csv", modelType))
+            return -1;
+        if (modelType == CcmModelType::Linear3x3) {
+            LCC(img, dst);
+        } else {
+            CcmModel model;
+            if (!readCcmModel(ccmModelPath("./ref/LCC_CMC.csv", modelType), model))
+                return -1;
+            applyCcmModel(img, dst, model);
+        }
+        cv::imwrite("./imgs/result.bmp", dst);
+        return 0;
+    }
+
     LCC_CMC(img);
     LCC(img,dst);
     
@@ -20,5 +119,3 @@ int main(int argc, const char * argv[]) {
     
     return 0;
 }
-
-
@@ -1,5 +1,10 @@
 #include <iostream>
 #include "Linear_CCM.hpp"
+#include "ccm_kernel.hpp"
+#include "ccm_store.hpp"
+#include "chart_detect.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
 #include <opencv4/opencv2/opencv.hpp>
 #include <opencv4/opencv2/core.hpp>
 #include <opencv4/opencv2/highgui.hpp>
@@ -88,7 +93,6 @@ void ROISelection(cv::Mat &img, cv::Mat &OriginalColor)
                 OPtr[0] = CropSum[0];
                 OPtr[1] = CropSum[1];
                 OPtr[2] = CropSum[2];
-                OPtr[3] = CropSum[3];
                 
                 ROICount++;
             }
@@ -117,75 +121,48 @@ cv::Mat convertToRGBSpace(const cv::Mat& labImage) {
 // Hàm để tăng giá trị của một màu cụ thể
 cv::Mat enhanceColor(const cv::Mat& image, const cv::Vec3b& color, float factor) {
     cv::Mat result = image.clone();
-    for (int y = 0; y < result.rows; y++) {
-        for (int x = 0; x < result.cols; x++) {
-            cv::Vec3b& pixel = result.at<cv::Vec3b>(y, x);
-            for (int c = 0; c < 3; c++) {
-                if (std::abs(pixel[c] - color[c]) < 30) {  // Ngưỡng cho sự tương đồng màu
-                    pixel[c] = cv::saturate_cast<uchar>(pixel[c] * factor);
+    parallelRows(result.rows, [&](int rowStart, int rowEnd) {
+        for (int y = rowStart; y < rowEnd; y++) {
+            cv::Vec3b* row = result.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < result.cols; x++) {
+                cv::Vec3b& pixel = row[x];
+                for (int c = 0; c < 3; c++) {
+                    if (std::abs(pixel[c] - color[c]) < 30) {  // Ngưỡng cho sự tương đồng màu
+                        pixel[c] = cv::saturate_cast<uchar>(pixel[c] * factor);
+                    }
                 }
             }
         }
-    }
+    });
     return result;
 }
+// CCM = (O^T * O)^-1 * O^T * R, O: measured patch colours, R: reference colours (24x3 each)
+cv::Mat solveColorMatrix(const cv::Mat &OriginalColor, const cv::Mat &ReferenceColor)
+{
+    cv::Mat O_T = OriginalColor.t(); // chuyen vi ma tran O
+    cv::Mat temp = O_T*OriginalColor; // O^T * O
+    return temp.inv() * O_T * ReferenceColor; // nghich dao (O^T*O)  * ReferenceColor
+}
+
 void LCC_CMC(cv::Mat &img)
 {
-    
-    int i = 0, j = 0;
-    
-    cv::Mat ReferenceColor(24, 3, CV_32FC1, cv::Scalar(0));
-    
-    std::fstream infile;
+    cv::Mat ReferenceColor;
     // gia tri bang mau tham chieu tu file ReferenceColor
-    infile.open("ref/ReferenceColor.csv", std::ios::in);
-    
-    if (!infile)
-    {
-        std::cerr << "Open the reference color file error" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    
-    std::string textline;
-    while (getline(infile, textline))
-    {
-        float *RefP = ReferenceColor.ptr<float>(i);
-        j = 0;
-        std::string::size_type pos = 0, prev_pos = 0;
-        while ((pos = textline.find_first_of(',', pos)) != std::string::npos)
-        {
-            
-            RefP[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-            prev_pos = ++pos;
-        }
-        // Luu cac gia tri tu bang mau tham chieu vao RefP su dung func: ReferenceColor
-        RefP[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-        i++;
-    }
+    if (!readReferenceColors("ref/ReferenceColor.csv", ReferenceColor))
+        return;
     
     cv::Mat OriginalColor(24, 3, CV_32FC1, cv::Scalar(0));
     
     ROISelection(img, OriginalColor);
     // tinh toan ma tran hieu chinh mau
     // Sử dụng công thức: CCM = (O^T * O)^-1 * O^T * R Trong đó O là ma trận màu gốc, R là ma trận màu tham chiếu
-    cv::Mat O_T = OriginalColor.t(); // chuyen vi ma tran O
-    cv::Mat temp = O_T*OriginalColor; // O^T * O
-    cv::Mat ColorMatrix(3, 3, CV_32FC1, cv::Scalar(0));
-    ColorMatrix = temp.inv() * O_T * ReferenceColor; // nghich dao (O^T*O)  * ReferenceColor
+    cv::Mat ColorMatrix = solveColorMatrix(OriginalColor, ReferenceColor);
     
     std::cout << "CCM da tinh xong.!" << std::endl;
     // Lưu CCM vào file
-    std::ofstream outfile("./ref/LCC_CMC.csv");
-    if (outfile)
+    if (writeColorCorrectionMatrix("./ref/LCC_CMC.csv", cv::Matx33f(ColorMatrix)))
     {
-        for (i = 0; i < 3; ++i)
-        {
-            for (j = 0; j < 3; ++j)
-            {
-                outfile << ColorMatrix.at<float>(i, j) << ",";
-            }
-            outfile << "\n";
-        }
+        CcmStore::shared("ref/LCC_CMC.csv").publish(cv::Matx33f(ColorMatrix), "LCC_CMC");
         std::cout << "CCM đã được lưu vào file ./ref/LCC_CMC.csv" << std::endl;
     }
     else
@@ -195,59 +172,51 @@ void LCC_CMC(cv::Mat &img)
     
 }
 
-// AP dung ma tran chinh mau
-void LCC(cv::Mat &img,cv::Mat &Dst)
+// LCC_CMC without a display: the chart is located automatically (chart_detect.hpp)
+bool LCC_CMC_Auto(const cv::Mat &img, const std::string &outputPath, CcmModelType modelType)
 {
-    int i = 0, j = 0;
-
-    int channels = img.channels();
-    int ImgHeight = img.rows, ImgWidth = img.cols;
-
-    // printf("%d %d %d\n",channels, ImgWidth, ImgWidth*channels);
-
-    std::fstream CMC("ref/LCC_CMC.csv", std::ios::in);
-    
-    if (!CMC)
-    {
-        std::cerr << "Open the file error" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    
-    cv::Mat ColorMatrix(3, 3, CV_32FC1, cv::Scalar(0));
+    cv::Mat ReferenceColor;
+    if (!readReferenceColors("ref/ReferenceColor.csv", ReferenceColor))
+        return false;
     
-    std::string textline;
-    while (getline(CMC, textline))
+    ChartDetection chart = detectColorChart(img, ReferenceColor);
+    if (!chart.found)
     {
-        std::string::size_type pos = 0, prev_pos = 0;
-        float *CMCPtr = ColorMatrix.ptr<float>(i);
-        j = 0;
-        while ((pos = textline.find_first_of(',', pos)) != std::string::npos)
-        {
-            CMCPtr[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-            prev_pos = ++pos;
-        }
-        i++;
+        std::cerr << "Color chart not found";
+        if (chart.residual > 0)
+            std::cerr << " (best fit residual " << chart.residual << ")";
+        std::cerr << std::endl;
+        return false;
     }
-    CMC.close();
-    
-    
-    Dst = img.clone();
-    
-    float *CMC_1 = ColorMatrix.ptr<float>(0);
-    float *CMC_2 = ColorMatrix.ptr<float>(1);
-    float *CMC_3 = ColorMatrix.ptr<float>(2);
-    
-    for (i = 0; i < ImgHeight; ++i)
+    std::cout << "Chart: " << chart.patchesSeen << "/24 patches seen, residual " << chart.residual << std::endl;
+    
+    CcmModel model;
+    if (!fitCcmModel(modelType, chart.patchColors, ReferenceColor, model))
+        return false;
+    std::cout << "Model " << ccmModelName(modelType) << ": patch RMS error "
+              << ccmModelResidual(model, chart.patchColors, ReferenceColor) << std::endl;
+    // Non-linear models get their own file; outputPath stays a 3x3 matrix.
+    const std::string path = ccmModelPath(outputPath, modelType);
+    if (!writeCcmModel(path, model))
+        return false;
+    if (modelType == CcmModelType::Linear3x3)
+        CcmStore::shared(path).publish(model.matrix(), "LCC_CMC_Auto");
+    std::cout << "CCM đã được lưu vào file " << path << std::endl;
+    return true;
+}
+
+// AP dung ma tran chinh mau
+void LCC(cv::Mat &img,cv::Mat &Dst)
+{
+    CCM_TRACE_SCOPE("LCC");
+    // Parsed once per process; every later call reuses the cached snapshot.
+    std::shared_ptr<const CcmSnapshot> ccm = CcmStore::shared("ref/LCC_CMC.csv").current();
+    if (!ccm)
     {
-        uchar *SP = img.ptr<uchar>(i); // gia trij pixel tai anh goc
-        uchar *DP = Dst.ptr<uchar>(i);
-        for (j = 0; j < ImgWidth*channels; j += 3) // channels = 3 kenh mau
-        {
-            // saturate_cast: dam bao gia tri pixel nam trong [0;255]
-            DP[j] = cv::saturate_cast<uchar>(SP[j] * CMC_1[0] + SP[j + 1] * CMC_2[0] + SP[j+2] * CMC_3[0]);
-            DP[j+1] = cv::saturate_cast<uchar>(SP[j] * CMC_1[1] + SP[j + 1] * CMC_2[1] + SP[j+2] * CMC_3[1]);
-            DP[j+2] = cv::saturate_cast<uchar>(SP[j] * CMC_1[2] + SP[j + 1] * CMC_2[2] + SP[j+2] * CMC_3[2]);
-        }
+        std::cerr << "No colour correction matrix, image left uncorrected" << std::endl;
+        img.copyTo(Dst);
+        return;
     }
-    
-}
+
+    applyCCM(img, Dst, ccm->matrix);
+}
\ No newline at end of file
@@ -3,8 +3,17 @@
 
 #include <opencv2/opencv.hpp>
 #include <fstream>
+#include <string>
+
+#include "ccm_model.hpp"
 
 //Linear Color Correction
 void LCC(cv::Mat &Src,cv::Mat &Dst);
 void LCC_CMC(cv::Mat &Src);
+// Headless calibration: locates the 24-patch chart in Src, fits and saves the CCM
+// (a linear model to outputPath, also published to the shared CcmStore; other
+// models to ccmModelPath(outputPath, type)).
+bool LCC_CMC_Auto(const cv::Mat &Src, const std::string &outputPath = "./ref/LCC_CMC.csv",
+                  CcmModelType model = CcmModelType::Linear3x3);
+cv::Mat solveColorMatrix(const cv::Mat &OriginalColor, const cv::Mat &ReferenceColor);
 #endif
@@ -0,0 +1,51 @@
+#include "alloc_counter.hpp"
+#include <opencv2/core.hpp>
+#include <atomic>
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocatedBytes{0};
+
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base_(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        cv::UMatData* u = base_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (u && !data) {
+            allocationCount.fetch_add(1, std::memory_order_relaxed);
+            allocatedBytes.fetch_add(u->size, std::memory_order_relaxed);
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override {
+        return base_->allocate(data, accessflags, usageFlags);
+    }
+
+    // Buffers are owned by the base allocator (u->currAllocator), so this is only
+    // reached through Mats that explicitly use the counting allocator.
+    void deallocate(cv::UMatData* data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator* base_;
+};
+
+} // namespace
+
+void enableMatAllocationCounter() {
+    static CountingMatAllocator counter(cv::Mat::getStdAllocator());
+    cv::Mat::setDefaultAllocator(&counter);
+}
+
+size_t matAllocationCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+size_t matAllocatedBytes() {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
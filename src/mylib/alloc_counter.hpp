@@ -0,0 +1,13 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+
+// Counts cv::Mat buffer allocations by wrapping OpenCV's default MatAllocator.
+// Only Mats created after enableMatAllocationCounter() are seen; call it at the
+// start of main() to measure per-frame allocations in a processing loop.
+void enableMatAllocationCounter();
+size_t matAllocationCount();
+size_t matAllocatedBytes();
+
+#endif // ALLOC_COUNTER_H
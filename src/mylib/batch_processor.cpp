@@ -0,0 +1,172 @@
+#include "batch_processor.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool readFile(const std::string& path, std::vector<uchar>& buffer) {
+    CCM_TRACE_SCOPE("readFile");
+    std::ifstream infile(path, std::ios::binary | std::ios::ate);
+    if (!infile)
+        return false;
+    std::streamsize size = infile.tellg();
+    infile.seekg(0);
+    buffer.resize(static_cast<size_t>(size));
+    return static_cast<bool>(infile.read(reinterpret_cast<char*>(buffer.data()), size));
+}
+
+bool writeFile(const std::string& path, const std::vector<uchar>& buffer) {
+    CCM_TRACE_SCOPE("writeFile");
+    std::ofstream outfile(path, std::ios::binary);
+    outfile.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(outfile);
+}
+
+// Prints finished items strictly in input order, whatever order workers finish in.
+class OrderedReporter {
+public:
+    OrderedReporter(const std::vector<BatchItem>& items, bool verbose)
+        : items_(items), status_(items.size(), Pending), verbose_(verbose) {}
+
+    void finish(size_t index, bool ok) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_[index] = ok ? Done : Failed;
+        while (next_ < status_.size() && status_[next_] != Pending) {
+            if (status_[next_] == Failed)
+                std::cerr << "[" << next_ + 1 << "/" << items_.size() << "] Failed: " << items_[next_].input << std::endl;
+            else if (verbose_)
+                std::cout << "[" << next_ + 1 << "/" << items_.size() << "] Saved: " << items_[next_].output << std::endl;
+            next_++;
+        }
+    }
+
+private:
+    enum Status { Pending, Done, Failed };
+    const std::vector<BatchItem>& items_;
+    std::vector<Status> status_;
+    size_t next_ = 0;
+    bool verbose_;
+    std::mutex mutex_;
+};
+
+struct BatchMetrics {
+    LatencyHistogram& image = metrics().histogram("ccm_stage_latency_seconds", "Per-frame latency of each stage", "stage=\"image\"");
+    LatencyHistogram& process = metrics().histogram("ccm_stage_latency_seconds", "Per-frame latency of each stage", "stage=\"process\"");
+    Counter& images = metrics().counter("ccm_images_processed_total", "Images written successfully");
+    Counter& failed = metrics().counter("ccm_images_failed_total", "Images that could not be read, processed or written");
+    Counter& bytesRead = metrics().counter("ccm_bytes_read_total", "Bytes read from input files");
+    Counter& bytesWritten = metrics().counter("ccm_bytes_written_total", "Bytes written to output files");
+};
+
+BatchMetrics& batchMetrics() {
+    static BatchMetrics instance;
+    return instance;
+}
+
+} // namespace
+
+std::vector<BatchItem> collectImages(const std::string& inputDir, const std::string& outputDir,
+                                     const std::vector<std::string>& extensions) {
+    std::vector<BatchItem> items;
+    for (const auto & entry : fs::directory_iterator(inputDir)) {
+        if (!entry.is_regular_file())
+            continue;
+        std::string ext = entry.path().extension().string();
+        if (!extensions.empty() && std::find(extensions.begin(), extensions.end(), ext) == extensions.end())
+            continue;
+        items.push_back({entry.path().string(), outputDir + "/" + entry.path().filename().string()});
+    }
+    std::sort(items.begin(), items.end(), [](const BatchItem& a, const BatchItem& b) { return a.input < b.input; });
+    return items;
+}
+
+BatchSummary runImageBatch(const std::vector<BatchItem>& items, const ImageProcessor& process,
+                           const BatchOptions& options) {
+    int workers = options.concurrency > 0 ? options.concurrency
+                                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers = std::max(1, std::min(workers, static_cast<int>(items.size())));
+
+    OrderedReporter reporter(items, options.verbose);
+    std::atomic<size_t> nextItem{0}, failed{0}, bytesRead{0}, bytesWritten{0};
+    BatchMetrics& m = batchMetrics();
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        CCM_TRACE_THREAD("batch worker");
+        std::vector<uchar> fileBuffer, encoded;
+        cv::Mat img, corrected;
+        for (size_t i = nextItem++; i < items.size(); i = nextItem++) {
+            const BatchItem& item = items[i];
+            bool ok = false;
+            CCM_TRACE_FRAME("image", i);
+            auto imageStart = std::chrono::steady_clock::now();
+            try {
+                if (readFile(item.input, fileBuffer)) {
+                    bytesRead += fileBuffer.size();
+                    m.bytesRead.add(fileBuffer.size());
+                    {
+                        CCM_TRACE_SCOPE("imdecode");
+                        cv::imdecode(fileBuffer, cv::IMREAD_COLOR, &img);
+                    }
+                    bool processed = false;
+                    if (!img.empty()) {
+                        CCM_TRACE_SCOPE("process");
+                        auto t = std::chrono::steady_clock::now();
+                        processed = process(img, corrected, item);
+                        m.process.record(std::chrono::steady_clock::now() - t);
+                    }
+                    if (processed) {
+                        CCM_TRACE_SCOPE("imencode");
+                        std::string ext = fs::path(item.output).extension().string();
+                        if (cv::imencode(ext, corrected, encoded) && writeFile(item.output, encoded)) {
+                            bytesWritten += encoded.size();
+                            m.bytesWritten.add(encoded.size());
+                            ok = true;
+                        }
+                    }
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error processing " << item.input << ": " << e.what() << std::endl;
+            }
+            if (ok) {
+                m.images.add();
+                m.image.record(std::chrono::steady_clock::now() - imageStart);
+            } else {
+                failed++;
+                m.failed.add();
+            }
+            reporter.finish(i, ok);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < workers; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool)
+        t.join();
+
+    BatchSummary summary;
+    summary.failed = failed;
+    summary.images = items.size() - summary.failed;
+    summary.bytesRead = bytesRead;
+    summary.bytesWritten = bytesWritten;
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+void printBatchSummary(std::ostream& os, const BatchSummary& summary) {
+    os << "Images: " << summary.images << " ok, " << summary.failed << " failed in " << summary.seconds << " s"
+       << " (" << summary.imagesPerSecond() << " images/s, " << summary.megabytesPerSecond() << " MB/s, "
+       << summary.bytesRead / 1e6 << " MB read, " << summary.bytesWritten / 1e6 << " MB written)" << std::endl;
+}
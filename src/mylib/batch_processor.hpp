@@ -0,0 +1,43 @@
+#ifndef BATCH_PROCESSOR_H
+#define BATCH_PROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BatchItem {
+    std::string input, output;
+};
+
+struct BatchOptions {
+    int concurrency = 0;      // worker threads, 0 = one per core
+    bool verbose = true;      // print one progress line per image, in input order
+};
+
+struct BatchSummary {
+    size_t images = 0, failed = 0;
+    size_t bytesRead = 0, bytesWritten = 0;
+    double seconds = 0;
+
+    double imagesPerSecond() const { return seconds > 0 ? images / seconds : 0; }
+    double megabytesPerSecond() const { return seconds > 0 ? (bytesRead + bytesWritten) / 1e6 / seconds : 0; }
+};
+
+// Correct one decoded image into dst. Return false to mark the item as failed.
+using ImageProcessor = std::function<bool(const cv::Mat& src, cv::Mat& dst, const BatchItem& item)>;
+
+// Files in inputDir (sorted by name) mapped to outputDir/<filename>.
+// An empty extension list accepts every regular file.
+std::vector<BatchItem> collectImages(const std::string& inputDir, const std::string& outputDir,
+                                     const std::vector<std::string>& extensions = {".jpg", ".png"});
+
+// Read -> decode -> process -> encode -> write, with `concurrency` images in flight.
+// Each worker keeps its own file, image and encode buffers.
+BatchSummary runImageBatch(const std::vector<BatchItem>& items, const ImageProcessor& process,
+                           const BatchOptions& options = BatchOptions());
+
+void printBatchSummary(std::ostream& os, const BatchSummary& summary);
+
+#endif // BATCH_PROCESSOR_H
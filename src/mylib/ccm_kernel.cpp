@@ -0,0 +1,127 @@
+#include "ccm_kernel.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include <cmath>
+#include "parallel.hpp"
+#include "trace.hpp"
+
+namespace {
+
+const int CCM_Q = 12;
+const int CCM_ROUND = 1 << (CCM_Q - 1);
+
+// q[c][k]: weight of input channel k for output channel c, in Q12.
+bool quantizeMatrix(const cv::Matx33f& M, short q[3][3]) {
+    for (int c = 0; c < 3; c++) {
+        for (int k = 0; k < 3; k++) {
+            float v = std::round(M(k, c) * (1 << CCM_Q));
+            if (std::fabs(v) > 32767.0f)
+                return false;
+            q[c][k] = static_cast<short>(v);
+        }
+    }
+    return true;
+}
+
+void ccmRowFloat(const uchar* SP, uchar* DP, int width, const cv::Matx33f& M) {
+    for (int j = 0; j < width * 3; j += 3) {
+        float b = SP[j], g = SP[j + 1], r = SP[j + 2];
+        DP[j]     = cv::saturate_cast<uchar>(b * M(0, 0) + g * M(1, 0) + r * M(2, 0));
+        DP[j + 1] = cv::saturate_cast<uchar>(b * M(0, 1) + g * M(1, 1) + r * M(2, 1));
+        DP[j + 2] = cv::saturate_cast<uchar>(b * M(0, 2) + g * M(1, 2) + r * M(2, 2));
+    }
+}
+
+void ccmRowFixed(const uchar* SP, uchar* DP, int from, int to, const short q[3][3]) {
+    for (int j = from * 3; j < to * 3; j += 3) {
+        int b = SP[j], g = SP[j + 1], r = SP[j + 2];
+        for (int c = 0; c < 3; c++) {
+            int acc = b * q[c][0] + g * q[c][1] + r * q[c][2] + CCM_ROUND;
+            DP[j + c] = cv::saturate_cast<uchar>(acc >> CCM_Q);
+        }
+    }
+}
+
+#if CV_SIMD
+// Two int16 coefficients packed into every int32 lane, matching the even/odd
+// layout produced by v_zip so that v_dotprod computes a*x + b*y per pixel.
+inline cv::v_int16 pairCoefficients(short a, short b) {
+    int packed = static_cast<int>(static_cast<unsigned short>(a)) | (static_cast<int>(b) << 16);
+    return cv::v_reinterpret_as_s16(cv::v_setall_s32(packed));
+}
+
+int ccmRowSimd(const uchar* SP, uchar* DP, int width, const cv::v_int16 coefBG[3], const cv::v_int16 coefR1[3]) {
+    const int VW = cv::v_uint8::nlanes;
+    const cv::v_int16 one = cv::v_setall_s16(1);
+    int x = 0;
+    for (; x <= width - VW; x += VW) {
+        cv::v_uint8 b, g, r;
+        cv::v_load_deinterleave(SP + x * 3, b, g, r);
+
+        cv::v_uint16 bh[2], gh[2], rh[2];
+        cv::v_expand(b, bh[0], bh[1]);
+        cv::v_expand(g, gh[0], gh[1]);
+        cv::v_expand(r, rh[0], rh[1]);
+
+        cv::v_uint16 out16[3][2];
+        for (int h = 0; h < 2; h++) {
+            cv::v_int16 bg0, bg1, r10, r11;
+            cv::v_zip(cv::v_reinterpret_as_s16(bh[h]), cv::v_reinterpret_as_s16(gh[h]), bg0, bg1);
+            cv::v_zip(cv::v_reinterpret_as_s16(rh[h]), one, r10, r11);
+            for (int c = 0; c < 3; c++) {
+                cv::v_int32 lo = cv::v_dotprod(bg0, coefBG[c]) + cv::v_dotprod(r10, coefR1[c]);
+                cv::v_int32 hi = cv::v_dotprod(bg1, coefBG[c]) + cv::v_dotprod(r11, coefR1[c]);
+                out16[c][h] = cv::v_pack_u(cv::v_shr<CCM_Q>(lo), cv::v_shr<CCM_Q>(hi));
+            }
+        }
+
+        cv::v_store_interleave(DP + x * 3,
+                               cv::v_pack(out16[0][0], out16[0][1]),
+                               cv::v_pack(out16[1][0], out16[1][1]),
+                               cv::v_pack(out16[2][0], out16[2][1]));
+    }
+    return x;
+}
+#endif
+
+} // namespace
+
+void applyCCM(const cv::Mat& src, cv::Mat& dst, const cv::Matx33f& ColorMatrix) {
+    CCM_TRACE_SCOPE("applyCCM");
+    CV_Assert(src.type() == CV_8UC3);
+    dst.create(src.size(), src.type());
+
+    short q[3][3];
+    bool fixedPoint = quantizeMatrix(ColorMatrix, q);
+
+#if CV_SIMD
+    cv::v_int16 coefBG[3], coefR1[3];
+    for (int c = 0; c < 3; c++) {
+        coefBG[c] = pairCoefficients(q[c][0], q[c][1]);
+        coefR1[c] = pairCoefficients(q[c][2], static_cast<short>(CCM_ROUND));
+    }
+#endif
+
+    parallelRows(src.rows, [&](int rowStart, int rowEnd) {
+        for (int i = rowStart; i < rowEnd; i++) {
+            const uchar* SP = src.ptr<uchar>(i);
+            uchar* DP = dst.ptr<uchar>(i);
+            if (!fixedPoint) {
+                ccmRowFloat(SP, DP, src.cols, ColorMatrix);
+                continue;
+            }
+            int x = 0;
+#if CV_SIMD
+            x = ccmRowSimd(SP, DP, src.cols, coefBG, coefR1);
+#endif
+            ccmRowFixed(SP, DP, x, src.cols, q);
+        }
+    });
+}
+
+void applyCCM(const cv::Mat& src, cv::Mat& dst, const cv::Mat& ColorMatrix) {
+    CV_Assert(ColorMatrix.rows == 3 && ColorMatrix.cols == 3);
+    cv::Matx33f M;
+    cv::Mat wrapped(3, 3, CV_32F, M.val);
+    ColorMatrix.convertTo(wrapped, CV_32F);
+    applyCCM(src, dst, M);
+}
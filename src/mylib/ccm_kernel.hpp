@@ -0,0 +1,16 @@
+#ifndef CCM_KERNEL_H
+#define CCM_KERNEL_H
+
+#include <opencv2/opencv.hpp>
+
+// Shared 3x3 colour correction kernel.
+// ColorMatrix follows the LCC_CMC.csv layout: row k holds the weights of input
+// channel k (B, G, R) and column c produces output channel c, i.e.
+//     dst[c] = src[B] * M(0, c) + src[G] * M(1, c) + src[R] * M(2, c)
+// The matrix is quantized to int16 Q12 and applied with OpenCV universal intrinsics
+// (SSE/AVX2/AVX-512/NEON, whichever the build targets); results are within 1 code
+// of the float reference. Matrices with |coefficient| >= 8 fall back to float math.
+void applyCCM(const cv::Mat& src, cv::Mat& dst, const cv::Matx33f& ColorMatrix);
+void applyCCM(const cv::Mat& src, cv::Mat& dst, const cv::Mat& ColorMatrix);
+
+#endif // CCM_KERNEL_H
@@ -0,0 +1,319 @@
+#include "ccm_model.hpp"
+#include "ccm_kernel.hpp"
+#include "ccm_store.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+namespace {
+
+template <CcmModelType Type>
+constexpr int termCount() {
+    if constexpr (Type == CcmModelType::Linear3x3)
+        return 3;
+    else if constexpr (Type == CcmModelType::Affine3x4)
+        return 4;
+    else if constexpr (Type == CcmModelType::Poly2)
+        return 10;
+    else if constexpr (Type == CcmModelType::Poly3)
+        return 20;
+    else
+        return 13;
+}
+
+// b, g, r in [0, 1].
+template <CcmModelType Type>
+inline void expandTerms(float b, float g, float r, float* t) {
+    t[0] = b;
+    t[1] = g;
+    t[2] = r;
+    if constexpr (Type == CcmModelType::Affine3x4) {
+        t[3] = 1;
+    } else if constexpr (Type == CcmModelType::Poly2 || Type == CcmModelType::Poly3) {
+        t[3] = b * b;
+        t[4] = g * g;
+        t[5] = r * r;
+        t[6] = b * g;
+        t[7] = g * r;
+        t[8] = r * b;
+        if constexpr (Type == CcmModelType::Poly3) {
+            t[9] = t[3] * b;
+            t[10] = t[4] * g;
+            t[11] = t[5] * r;
+            t[12] = b * t[4];
+            t[13] = g * t[5];
+            t[14] = r * t[3];
+            t[15] = g * t[3];
+            t[16] = r * t[4];
+            t[17] = b * t[5];
+            t[18] = t[6] * r;
+            t[19] = 1;
+        } else {
+            t[9] = 1;
+        }
+    } else if constexpr (Type == CcmModelType::RootPoly) {
+        t[3] = std::sqrt(b * g);
+        t[4] = std::sqrt(g * r);
+        t[5] = std::sqrt(r * b);
+        t[6] = std::cbrt(b * g * g);
+        t[7] = std::cbrt(g * b * b);
+        t[8] = std::cbrt(g * r * r);
+        t[9] = std::cbrt(r * g * g);
+        t[10] = std::cbrt(b * r * r);
+        t[11] = std::cbrt(r * b * b);
+        t[12] = std::cbrt(b * g * r);
+    }
+}
+
+// Calls fn(std::integral_constant<CcmModelType, type>) so the body is compiled once per model.
+template <typename Fn>
+void withModelType(CcmModelType type, Fn&& fn) {
+    switch (type) {
+    case CcmModelType::Linear3x3: fn(std::integral_constant<CcmModelType, CcmModelType::Linear3x3>()); break;
+    case CcmModelType::Affine3x4: fn(std::integral_constant<CcmModelType, CcmModelType::Affine3x4>()); break;
+    case CcmModelType::Poly2: fn(std::integral_constant<CcmModelType, CcmModelType::Poly2>()); break;
+    case CcmModelType::Poly3: fn(std::integral_constant<CcmModelType, CcmModelType::Poly3>()); break;
+    case CcmModelType::RootPoly: fn(std::integral_constant<CcmModelType, CcmModelType::RootPoly>()); break;
+    }
+}
+
+template <CcmModelType Type>
+void applyModelKernel(const cv::Mat& src, cv::Mat& dst, const cv::Mat& coefficients) {
+    constexpr int T = termCount<Type>();
+    float coef[T][3];
+    for (int k = 0; k < T; k++)
+        for (int c = 0; c < 3; c++)
+            coef[k][c] = coefficients.at<float>(k, c);
+    float scaled[256];
+    for (int i = 0; i < 256; i++)
+        scaled[i] = i / 255.0f;
+
+    parallelRows(src.rows, [&](int rowStart, int rowEnd) {
+        float t[T];
+        for (int y = rowStart; y < rowEnd; y++) {
+            const uchar* SP = src.ptr<uchar>(y);
+            uchar* DP = dst.ptr<uchar>(y);
+            for (int x = 0; x < src.cols; x++, SP += 3, DP += 3) {
+                expandTerms<Type>(scaled[SP[0]], scaled[SP[1]], scaled[SP[2]], t);
+                float out[3] = {0, 0, 0};
+                for (int k = 0; k < T; k++) {
+                    out[0] += t[k] * coef[k][0];
+                    out[1] += t[k] * coef[k][1];
+                    out[2] += t[k] * coef[k][2];
+                }
+                DP[0] = cv::saturate_cast<uchar>(out[0]);
+                DP[1] = cv::saturate_cast<uchar>(out[1]);
+                DP[2] = cv::saturate_cast<uchar>(out[2]);
+            }
+        }
+    });
+}
+
+// N x terms design matrix (CV_64F) of the given colours.
+cv::Mat designMatrix(CcmModelType type, const cv::Mat& colors) {
+    cv::Mat O;
+    colors.convertTo(O, CV_32F, 1.0 / 255);
+    cv::Mat A(O.rows, ccmModelTerms(type), CV_64F);
+    withModelType(type, [&](auto tag) {
+        constexpr CcmModelType Type = decltype(tag)::value;
+        float t[termCount<Type>()];
+        for (int n = 0; n < O.rows; n++) {
+            const float* o = O.ptr<float>(n);
+            expandTerms<Type>(o[0], o[1], o[2], t);
+            for (int k = 0; k < termCount<Type>(); k++)
+                A.at<double>(n, k) = t[k];
+        }
+    });
+    return A;
+}
+
+} // namespace
+
+int ccmModelTerms(CcmModelType type) {
+    int terms = 0;
+    withModelType(type, [&](auto tag) { terms = termCount<decltype(tag)::value>(); });
+    return terms;
+}
+
+const char* ccmModelName(CcmModelType type) {
+    switch (type) {
+    case CcmModelType::Linear3x3: return "linear";
+    case CcmModelType::Affine3x4: return "affine";
+    case CcmModelType::Poly2: return "poly2";
+    case CcmModelType::Poly3: return "poly3";
+    case CcmModelType::RootPoly: return "rootpoly";
+    }
+    return "linear";
+}
+
+bool parseCcmModelType(const std::string& name, CcmModelType& type) {
+    for (CcmModelType t : {CcmModelType::Linear3x3, CcmModelType::Affine3x4, CcmModelType::Poly2,
+                           CcmModelType::Poly3, CcmModelType::RootPoly}) {
+        if (name == ccmModelName(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+cv::Matx33f CcmModel::matrix() const {
+    CV_Assert(type == CcmModelType::Linear3x3 && coefficients.rows == 3);
+    return cv::Matx33f(cv::Mat(coefficients / 255.0));
+}
+
+CcmModel CcmModel::linear(const cv::Matx33f& ColorMatrix) {
+    CcmModel model;
+    model.coefficients = cv::Mat(ColorMatrix * 255.0f, true);
+    return model;
+}
+
+bool fitCcmModel(CcmModelType type, const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor, CcmModel& model) {
+    CV_Assert(OriginalColor.cols == 3 && ReferenceColor.cols == 3 && OriginalColor.rows == ReferenceColor.rows);
+    if (OriginalColor.rows < ccmModelTerms(type)) {
+        std::cerr << "Model " << ccmModelName(type) << " needs at least " << ccmModelTerms(type) << " patches" << std::endl;
+        return false;
+    }
+    cv::Mat A = designMatrix(type, OriginalColor);
+    cv::Mat R, X;
+    ReferenceColor.convertTo(R, CV_64F);
+    if (!cv::solve(A, R, X, cv::DECOMP_SVD))
+        return false;
+    model.type = type;
+    X.convertTo(model.coefficients, CV_32F);
+    return true;
+}
+
+double ccmModelResidual(const CcmModel& model, const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor) {
+    cv::Mat A = designMatrix(model.type, OriginalColor);
+    cv::Mat X, R;
+    model.coefficients.convertTo(X, CV_64F);
+    ReferenceColor.convertTo(R, CV_64F);
+    cv::Mat error = A * X - R;
+    return std::sqrt(error.dot(error) / error.total());
+}
+
+void applyCcmModel(const cv::Mat& src, cv::Mat& dst, const CcmModel& model) {
+    CCM_TRACE_SCOPE("applyCcmModel");
+    CV_Assert(src.type() == CV_8UC3 && !model.empty());
+    CV_Assert(model.coefficients.rows == ccmModelTerms(model.type) && model.coefficients.cols == 3);
+    if (model.type == CcmModelType::Linear3x3) {
+        applyCCM(src, dst, model.matrix());   // fixed-point SIMD path
+        return;
+    }
+    dst.create(src.size(), src.type());
+    withModelType(model.type, [&](auto tag) {
+        applyModelKernel<decltype(tag)::value>(src, dst, model.coefficients);
+    });
+}
+
+cv::Vec3f evalCcmModel(const CcmModel& model, const cv::Vec3f& bgr) {
+    cv::Vec3f out;
+    withModelType(model.type, [&](auto tag) {
+        constexpr CcmModelType Type = decltype(tag)::value;
+        float t[termCount<Type>()];
+        expandTerms<Type>(bgr[0] / 255, bgr[1] / 255, bgr[2] / 255, t);
+        for (int c = 0; c < 3; c++) {
+            float acc = 0;
+            for (int k = 0; k < termCount<Type>(); k++)
+                acc += t[k] * model.coefficients.at<float>(k, c);
+            out[c] = acc;
+        }
+    });
+    return out;
+}
+
+bool readCcmModel(const std::string& path, CcmModel& model) {
+    std::ifstream infile(path);
+    if (!infile) {
+        std::cerr << "Error opening the file: " << path << std::endl;
+        return false;
+    }
+    std::string textline;
+    while (getline(infile, textline) && textline.find_first_not_of(" \t\r") == std::string::npos) {
+    }
+    if (textline.compare(0, 6, "model,") != 0) {
+        // Legacy 3-row CSV: linear (read through the cached CCM reader).
+        cv::Matx33f M;
+        if (!readColorCorrectionMatrix(path, M))
+            return false;
+        model = CcmModel::linear(M);
+        return true;
+    }
+
+    std::string name = textline.substr(6);
+    name = name.substr(0, name.find_first_of(", \r"));
+    CcmModelType type;
+    if (!parseCcmModelType(name, type)) {
+        std::cerr << "Unknown CCM model '" << name << "' in " << path << std::endl;
+        return false;
+    }
+    const int terms = ccmModelTerms(type);
+    cv::Mat coefficients(terms, 3, CV_32F);
+    int row = 0;
+    while (getline(infile, textline)) {
+        std::stringstream line(textline);
+        std::string cell;
+        int col = 0;
+        while (getline(line, cell, ',')) {
+            if (cell.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            if (row >= terms || col >= 3) {
+                std::cerr << "Too many values in " << path << std::endl;
+                return false;
+            }
+            try {
+                coefficients.at<float>(row, col++) = std::stof(cell);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value '" << cell << "' in " << path << std::endl;
+                return false;
+            }
+        }
+        if (col == 0)
+            continue;
+        if (col != 3) {
+            std::cerr << "Expected 3 values per row in " << path << std::endl;
+            return false;
+        }
+        row++;
+    }
+    if (row != terms) {
+        std::cerr << "Expected " << terms << " rows for model " << name << " in " << path << std::endl;
+        return false;
+    }
+    model.type = type;
+    model.coefficients = coefficients;
+    return true;
+}
+
+bool writeCcmModel(const std::string& path, const CcmModel& model) {
+    if (model.type == CcmModelType::Linear3x3)
+        return writeColorCorrectionMatrix(path, model.matrix());
+
+    std::ofstream outfile(path);
+    if (!outfile) {
+        std::cerr << "Error opening the file: " << path << std::endl;
+        return false;
+    }
+    outfile << "model," << ccmModelName(model.type) << ",\n";
+    for (int k = 0; k < model.coefficients.rows; ++k) {
+        for (int c = 0; c < 3; ++c)
+            outfile << model.coefficients.at<float>(k, c) << ",";
+        outfile << "\n";
+    }
+    return static_cast<bool>(outfile);
+}
+
+std::string ccmModelPath(const std::string& linearPath, CcmModelType type) {
+    if (type == CcmModelType::Linear3x3)
+        return linearPath;
+    const size_t slash = linearPath.find_last_of('/');
+    size_t dot = linearPath.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = linearPath.size();
+    return linearPath.substr(0, dot) + "_" + ccmModelName(type) + linearPath.substr(dot);
+}
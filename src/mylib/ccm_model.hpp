@@ -0,0 +1,53 @@
+#ifndef CCM_MODEL_H
+#define CCM_MODEL_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// Colour correction models fitted from the 24 chart patches by least squares.
+// Each model expands a pixel into a fixed list of terms of its BGR values
+// (scaled to [0, 1]) and maps them to the output with a terms x 3 matrix:
+//
+//   Linear3x3  b g r                                       (3 terms, legacy CCM)
+//   Affine3x4  b g r 1                                     (4)
+//   Poly2      b g r b^2 g^2 r^2 bg gr rb 1                (10)
+//   Poly3      Poly2 terms + all 10 cubic monomials        (20)
+//   RootPoly   b g r, sqrt of the 3 cross products and cube roots of the
+//              7 cubic cross monomials; exposure invariant (13)
+enum class CcmModelType { Linear3x3, Affine3x4, Poly2, Poly3, RootPoly };
+
+int ccmModelTerms(CcmModelType type);
+const char* ccmModelName(CcmModelType type);
+bool parseCcmModelType(const std::string& name, CcmModelType& type);
+
+struct CcmModel {
+    CcmModelType type = CcmModelType::Linear3x3;
+    cv::Mat coefficients;   // terms x 3 CV_32F; row k = term k, column c = output channel (BGR, 0..255)
+
+    bool empty() const { return coefficients.empty(); }
+    // Linear models only: the classic LCC_CMC matrix (input in 0..255).
+    cv::Matx33f matrix() const;
+    static CcmModel linear(const cv::Matx33f& ColorMatrix);
+};
+
+// OriginalColor / ReferenceColor: Nx3 BGR rows (N >= number of terms).
+bool fitCcmModel(CcmModelType type, const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor, CcmModel& model);
+// RMS error of the model on the given patches, in 8-bit units.
+double ccmModelResidual(const CcmModel& model, const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor);
+
+// The kernel is instantiated per model type, so the term expansion and the
+// terms x 3 product are fully unrolled; the linear model uses applyCCM().
+void applyCcmModel(const cv::Mat& src, cv::Mat& dst, const CcmModel& model);
+cv::Vec3f evalCcmModel(const CcmModel& model, const cv::Vec3f& bgr);
+
+// File format: the legacy 3-row CSV is a linear model (and is what linear models
+// are written as); other models start with a "model,<name>," line followed by one
+// comma-terminated row of 3 coefficients per term.
+bool readCcmModel(const std::string& path, CcmModel& model);
+bool writeCcmModel(const std::string& path, const CcmModel& model);
+// Where a calibration of `type` is stored next to the linear CCM: linear models
+// use linearPath itself, the others <stem>_<name><ext> (ref/LCC_CMC_poly2.csv), so
+// the matrix-only readers of the linear path (CcmStore, LCC) never see them.
+std::string ccmModelPath(const std::string& linearPath, CcmModelType type);
+
+#endif // CCM_MODEL_H
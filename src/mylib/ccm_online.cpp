@@ -0,0 +1,101 @@
+#include "ccm_online.hpp"
+#include "trace.hpp"
+#include <iostream>
+
+OnlineCcmEstimator::OnlineCcmEstimator(double forgetting, double ridge)
+    : forgetting_(forgetting), ridge_(ridge), OtO_(cv::Matx33d::zeros()), OtR_(cv::Matx33d::zeros()) {}
+
+void OnlineCcmEstimator::update(const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor, double weight) {
+    CV_Assert(OriginalColor.cols == 3 && ReferenceColor.cols == 3 && OriginalColor.rows == ReferenceColor.rows);
+    cv::Mat O, R;
+    OriginalColor.convertTo(O, CV_64F);
+    ReferenceColor.convertTo(R, CV_64F);
+
+    OtO_ *= forgetting_;
+    OtR_ *= forgetting_;
+    for (int n = 0; n < O.rows; n++) {
+        const double* o = O.ptr<double>(n);
+        const double* r = R.ptr<double>(n);
+        for (int k = 0; k < 3; k++) {
+            for (int c = 0; c < 3; c++) {
+                OtO_(k, c) += weight * o[k] * o[c];
+                OtR_(k, c) += weight * o[k] * r[c];
+            }
+        }
+    }
+    updates_++;
+}
+
+bool OnlineCcmEstimator::solve(cv::Matx33f& ColorMatrix) const {
+    if (updates_ == 0)
+        return false;
+    // A tiny ridge, relative to the data scale, keeps the system solvable when
+    // the observed colours are nearly collinear (e.g. a mostly grey frame).
+    cv::Matx33d A = OtO_;
+    const double lambda = ridge_ * cv::trace(OtO_) / 3;
+    for (int k = 0; k < 3; k++)
+        A(k, k) += lambda;
+    cv::Matx33d M;
+    if (!cv::solve(A, OtR_, M, cv::DECOMP_CHOLESKY))
+        return false;
+    ColorMatrix = cv::Matx33f(M);
+    return true;
+}
+
+void OnlineCcmEstimator::reset() {
+    OtO_ = cv::Matx33d::zeros();
+    OtR_ = cv::Matx33d::zeros();
+    updates_ = 0;
+}
+
+OnlineChartCalibrator::OnlineChartCalibrator(CcmStore& store, const cv::Mat& ReferenceColor, double forgetting,
+                                             double maxResidual, const ChartDetectorOptions& options)
+    : store_(store), reference_(ReferenceColor.clone()), maxResidual_(maxResidual), options_(options),
+      estimator_(forgetting) {
+    worker_ = std::thread([this] { run(); });
+}
+
+OnlineChartCalibrator::~OnlineChartCalibrator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+bool OnlineChartCalibrator::offer(const cv::Mat& frame) {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || busy_)
+        return false;
+    frame.copyTo(pending_);   // same geometry every time: no allocation after the first offer
+    busy_ = true;
+    lock.unlock();
+    wake_.notify_one();
+    return true;
+}
+
+void OnlineChartCalibrator::run() {
+    CCM_TRACE_THREAD("chart tracker");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return busy_ || stop_; });
+        if (stop_)
+            return;
+        // pending_ is ours until busy_ is cleared, so detect without holding the lock.
+        lock.unlock();
+        ChartDetection chart = detectColorChart(pending_, reference_, options_);
+        if (chart.found && chart.residual <= maxResidual_) {
+            estimator_.update(chart.patchColors, reference_);
+            cv::Matx33f M;
+            if (estimator_.solve(M)) {
+                store_.publish(M, "chart tracking");
+                detections_++;
+            }
+        } else {
+            misses_++;
+        }
+        lock.lock();
+        busy_ = false;
+    }
+}
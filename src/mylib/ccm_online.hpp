@@ -0,0 +1,71 @@
+#ifndef CCM_ONLINE_H
+#define CCM_ONLINE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "ccm_store.hpp"
+#include "chart_detect.hpp"
+
+// Incremental least-squares CCM: keeps the normal equations O^T*O and O^T*R
+// (3x3 each) instead of the observations, so an update costs O(patches) and a
+// re-solve is a single 3x3 system, independent of how many frames were seen.
+// Older observations fade by `forgetting` per update (1 = plain accumulation),
+// which lets the matrix follow drifting light.
+class OnlineCcmEstimator {
+public:
+    explicit OnlineCcmEstimator(double forgetting = 0.9, double ridge = 1e-6);
+
+    // One observation set: Nx3 measured and Nx3 reference colours (rows match, BGR).
+    void update(const cv::Mat& OriginalColor, const cv::Mat& ReferenceColor, double weight = 1.0);
+    // Same layout as solveColorMatrix(): dst[c] = sum_k src[k] * M(k, c). False until solvable.
+    bool solve(cv::Matx33f& ColorMatrix) const;
+
+    void reset();
+    uint64_t updates() const { return updates_; }
+
+private:
+    double forgetting_, ridge_;
+    cv::Matx33d OtO_, OtR_;
+    uint64_t updates_ = 0;
+};
+
+// Chart tracking for a running video: frames offered by the frame loop are
+// searched for the colour chart on a worker thread; each detection updates an
+// OnlineCcmEstimator and publishes the new matrix to a CcmStore. offer() never
+// waits, a frame arriving while the worker is busy is simply not used.
+class OnlineChartCalibrator {
+public:
+    OnlineChartCalibrator(CcmStore& store, const cv::Mat& ReferenceColor, double forgetting = 0.9,
+                          double maxResidual = 30.0, const ChartDetectorOptions& options = ChartDetectorOptions());
+    ~OnlineChartCalibrator();
+    OnlineChartCalibrator(const OnlineChartCalibrator&) = delete;
+    OnlineChartCalibrator& operator=(const OnlineChartCalibrator&) = delete;
+
+    // Copies the frame for the worker; false if the worker is still busy.
+    bool offer(const cv::Mat& frame);
+
+    uint64_t detections() const { return detections_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    void run();
+
+    CcmStore& store_;
+    cv::Mat reference_;
+    double maxResidual_;
+    ChartDetectorOptions options_;
+    OnlineCcmEstimator estimator_;   // worker-owned
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    cv::Mat pending_;
+    bool busy_ = false, stop_ = false;
+    std::atomic<uint64_t> detections_{0}, misses_{0};
+    std::thread worker_;
+};
+
+#endif // CCM_ONLINE_H
@@ -0,0 +1,325 @@
+#include "ccm_store.hpp"
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'C', 'C', 'M', 'B'};
+constexpr uint32_t kFormatVersion = 1;
+
+struct CcmFileHeader {
+    char magic[4];
+    uint32_t formatVersion;
+    uint32_t rows, cols;
+    uint64_t sourceSize;    // 0 when not built from a CSV
+    int64_t sourceMtime;
+};
+
+struct CcmFile {
+    CcmFileHeader header;
+    float data[9];
+    uint32_t crc;
+};
+
+uint32_t crc32(const void* data, size_t size) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool sourceStamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = fs::file_size(path, ec);
+    if (ec)
+        return false;
+    mtime = static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+    return !ec;
+}
+
+bool parseCsv(const std::string& path, cv::Matx33f& M, std::string& error) {
+    std::ifstream CMC(path);
+    if (!CMC) {
+        error = "Error opening the file: " + path;
+        return false;
+    }
+
+    int row = 0;
+    std::string textline;
+    while (getline(CMC, textline)) {
+        if (textline.compare(0, 6, "model,") == 0) {
+            error = path + " holds a non-linear CCM model; read it with readCcmModel()";
+            return false;
+        }
+        std::stringstream line(textline);
+        std::string cell;
+        int col = 0;
+        while (getline(line, cell, ',')) {
+            if (cell.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            if (row >= 3 || col >= 3) {
+                error = "Too many values in " + path;
+                return false;
+            }
+            try {
+                M(row, col++) = std::stof(cell);
+            } catch (const std::exception&) {
+                error = "Invalid value '" + cell + "' in " + path;
+                return false;
+            }
+        }
+        if (col == 0)
+            continue;   // blank line
+        if (col != 3) {
+            error = "Expected 3 values per row in " + path;
+            return false;
+        }
+        row++;
+    }
+    if (row != 3) {
+        error = "Expected 3 rows in " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readBinary(const std::string& path, cv::Matx33f& M, const std::string& sourcePath, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Error opening the file: " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size != static_cast<off_t>(sizeof(CcmFile))) {
+        ::close(fd);
+        error = "Unexpected size of " + path;
+        return false;
+    }
+    void* mapped = mmap(nullptr, sizeof(CcmFile), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "Cannot map " + path;
+        return false;
+    }
+
+    CcmFile file;
+    std::memcpy(&file, mapped, sizeof(file));
+    munmap(mapped, sizeof(CcmFile));
+
+    if (std::memcmp(file.header.magic, kMagic, sizeof(kMagic)) != 0 || file.header.formatVersion != kFormatVersion ||
+        file.header.rows != 3 || file.header.cols != 3) {
+        error = "Not a version " + std::to_string(kFormatVersion) + " CCM file: " + path;
+        return false;
+    }
+    if (crc32(&file, offsetof(CcmFile, crc)) != file.crc) {
+        error = "Checksum mismatch in " + path;
+        return false;
+    }
+    if (!sourcePath.empty()) {
+        uint64_t size;
+        int64_t mtime;
+        if (!sourceStamp(sourcePath, size, mtime) || size != file.header.sourceSize || mtime != file.header.sourceMtime) {
+            error = path + " is stale";
+            return false;
+        }
+    }
+    for (int i = 0; i < 9; i++)
+        M.val[i] = file.data[i];
+    return true;
+}
+
+// Written to a temporary name and renamed, so readers never map a partial file.
+bool writeBinary(const std::string& path, const cv::Matx33f& M, const std::string& sourcePath) {
+    CcmFile file{};
+    std::memcpy(file.header.magic, kMagic, sizeof(kMagic));
+    file.header.formatVersion = kFormatVersion;
+    file.header.rows = 3;
+    file.header.cols = 3;
+    if (!sourcePath.empty() && !sourceStamp(sourcePath, file.header.sourceSize, file.header.sourceMtime))
+        return false;
+    for (int i = 0; i < 9; i++)
+        file.data[i] = M.val[i];
+    file.crc = crc32(&file, offsetof(CcmFile, crc));
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&file), sizeof(file));
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+} // namespace
+
+bool readColorCorrectionMatrix(const std::string& path, cv::Matx33f& ColorMatrix) {
+    std::string error;
+    if (fs::path(path).extension() == ".ccm") {
+        if (readBinary(path, ColorMatrix, "", error))
+            return true;
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    const std::string cache = path + ".ccm";
+    if (readBinary(cache, ColorMatrix, path, error))
+        return true;
+    if (!parseCsv(path, ColorMatrix, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    writeBinary(cache, ColorMatrix, path);   // best effort; ref/ may be read-only
+    return true;
+}
+
+bool readColorCorrectionMatrix(const std::string& path, cv::Mat& ColorMatrix) {
+    cv::Matx33f M;
+    if (!readColorCorrectionMatrix(path, M))
+        return false;
+    ColorMatrix = cv::Mat(M, true);
+    return true;
+}
+
+bool writeColorCorrectionMatrix(const std::string& path, const cv::Matx33f& ColorMatrix) {
+    std::ofstream outfile(path);
+    if (!outfile) {
+        std::cerr << "Error opening the file: " << path << std::endl;
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+            outfile << ColorMatrix(i, j) << ",";
+        outfile << "\n";
+    }
+    return static_cast<bool>(outfile);
+}
+
+bool writeCcmBinary(const std::string& path, const cv::Matx33f& ColorMatrix, const std::string& sourcePath) {
+    if (writeBinary(path, ColorMatrix, sourcePath))
+        return true;
+    std::cerr << "Error writing the file: " << path << std::endl;
+    return false;
+}
+
+bool readCcmBinary(const std::string& path, cv::Matx33f& ColorMatrix, const std::string& sourcePath) {
+    std::string error;
+    if (readBinary(path, ColorMatrix, sourcePath, error))
+        return true;
+    std::cerr << error << std::endl;
+    return false;
+}
+
+CcmStore::CcmStore(const std::string& path) : path_(path) {}
+
+CcmStore::~CcmStore() {
+    stopWatching();
+}
+
+bool CcmStore::load() {
+    cv::Matx33f M;
+    if (!readColorCorrectionMatrix(path_, M))
+        return false;
+    publish(M, path_);
+    return true;
+}
+
+void CcmStore::publish(const cv::Matx33f& matrix, const std::string& source) {
+    auto snapshot = std::make_shared<CcmSnapshot>();
+    snapshot->matrix = matrix;
+    snapshot->version = ++version_;
+    snapshot->source = source;
+    std::atomic_store(&snapshot_, std::shared_ptr<const CcmSnapshot>(std::move(snapshot)));
+}
+
+bool CcmStore::watch() {
+#ifdef __linux__
+    if (watcher_.joinable())
+        return true;
+    fs::path file(path_);
+    std::string dir = file.has_parent_path() ? file.parent_path().string() : ".";
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+    // Watch the directory: editors and calibration tools often replace the file by rename.
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    stopWatcher_ = false;
+    watcher_ = std::thread([this, fd, name = file.filename().string()] {
+        alignas(inotify_event) char buffer[4096];
+        while (!stopWatcher_.load()) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0)
+                continue;
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            bool changed = false;
+            for (ssize_t offset = 0; offset < n;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && name == event->name)
+                    changed = true;
+                offset += sizeof(inotify_event) + event->len;
+            }
+            if (changed && load())
+                std::cout << "Reloaded CCM v" << current()->version << " from " << path_ << std::endl;
+        }
+        ::close(fd);
+    });
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CcmStore::stopWatching() {
+    stopWatcher_ = true;
+    if (watcher_.joinable())
+        watcher_.join();
+}
+
+CcmStore& CcmStore::shared(const std::string& path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::unique_ptr<CcmStore>> stores;
+    std::lock_guard<std::mutex> lock(mutex);
+    // "./ref/x.csv" and "ref/x.csv" share one store.
+    const std::string key = fs::path(path).lexically_normal().string();
+    std::unique_ptr<CcmStore>& store = stores[key];
+    if (!store) {
+        store = std::make_unique<CcmStore>(key);
+        store->load();
+    }
+    return *store;
+}
@@ -0,0 +1,72 @@
+#ifndef CCM_STORE_H
+#define CCM_STORE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Loading and caching of the calibrated colour correction matrix.
+//
+// Text format (ref/LCC_CMC.csv, written by LCC_CMC): 3 rows of comma-separated
+// floats, trailing comma optional. Binary format (.ccm): fixed header with magic,
+// format version and the size/mtime of the CSV it was built from, 9 floats,
+// then a CRC32 of everything before it. It is read with mmap.
+
+// Reads a CSV or .ccm (by extension) matrix into a 3x3 CV_32F Mat.
+// For a CSV, a valid <path>.ccm cache built from the same file is used instead of
+// parsing, and is (re)written after parsing otherwise. Prints an error and returns
+// false on failure.
+bool readColorCorrectionMatrix(const std::string& path, cv::Mat& ColorMatrix);
+bool readColorCorrectionMatrix(const std::string& path, cv::Matx33f& ColorMatrix);
+
+bool writeColorCorrectionMatrix(const std::string& path, const cv::Matx33f& ColorMatrix);
+// sourcePath: the CSV the cache mirrors (its size and mtime are recorded), or empty.
+bool writeCcmBinary(const std::string& path, const cv::Matx33f& ColorMatrix, const std::string& sourcePath = "");
+bool readCcmBinary(const std::string& path, cv::Matx33f& ColorMatrix, const std::string& sourcePath = "");
+
+// One immutable calibration. Never modified after publication, so a frame
+// loop can keep using the snapshot it fetched while a newer one is published.
+struct CcmSnapshot {
+    cv::Matx33f matrix;
+    uint64_t version = 0;   // 1 for the first load, +1 per publish
+    std::string source;
+};
+
+// Holds the current snapshot behind a shared_ptr swapped with std::atomic_load /
+// std::atomic_store: readers never block on a reload and pay no parsing cost.
+// watch() starts an inotify thread that reloads the file when it is rewritten
+// (including editors that replace it via rename); a failed reload keeps the
+// previous snapshot.
+class CcmStore {
+public:
+    explicit CcmStore(const std::string& path);
+    ~CcmStore();
+    CcmStore(const CcmStore&) = delete;
+    CcmStore& operator=(const CcmStore&) = delete;
+
+    bool load();
+    void publish(const cv::Matx33f& matrix, const std::string& source);
+    // nullptr until a matrix has been loaded or published.
+    std::shared_ptr<const CcmSnapshot> current() const { return std::atomic_load(&snapshot_); }
+
+    // Linux only; returns false when file watching is unavailable.
+    bool watch();
+    void stopWatching();
+
+    const std::string& path() const { return path_; }
+
+    // Process-wide store per path, loaded on first use (used by LCC()).
+    static CcmStore& shared(const std::string& path = "ref/LCC_CMC.csv");
+
+private:
+    std::string path_;
+    std::shared_ptr<const CcmSnapshot> snapshot_;
+    std::atomic<uint64_t> version_{0};
+    std::thread watcher_;
+    std::atomic<bool> stopWatcher_{false};
+};
+
+#endif // CCM_STORE_H
@@ -0,0 +1,354 @@
+#include "chart_detect.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+constexpr int kChartCols = 6, kChartRows = 4, kPatches = kChartCols * kChartRows;
+
+struct Candidate {
+    cv::Point2f center;   // full-resolution pixels
+    float side;           // sqrt(area), full-resolution pixels
+    float angle;          // degrees, minAreaRect convention
+};
+
+std::vector<Candidate> findCandidates(const cv::Mat& img, int maxSide) {
+    const double scale = std::min(1.0, static_cast<double>(maxSide) / std::max(img.cols, img.rows));
+    cv::Mat small;
+    if (scale < 1.0)
+        cv::resize(img, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    else
+        small = img;
+    cv::GaussianBlur(small, small, cv::Size(3, 3), 0);
+
+    // Edges of every channel: neighbouring patches often differ in hue but not in luminance.
+    cv::Mat channels[3], edges, channelEdges;
+    cv::split(small, channels);
+    edges = cv::Mat::zeros(small.size(), CV_8U);
+    for (const cv::Mat& channel : channels) {
+        cv::Canny(channel, channelEdges, 20, 60);
+        edges |= channelEdges;
+    }
+    cv::dilate(edges, edges, cv::Mat::ones(3, 3, CV_8U));
+    cv::Mat regions = ~edges;
+
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<cv::Vec4i> hierarchy;
+    cv::findContours(regions, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE);
+
+    const double total = static_cast<double>(small.total());
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < contours.size(); i++) {
+        if (hierarchy[i][3] != -1)
+            continue;   // hole boundary, duplicates the region inside it
+        double area = cv::contourArea(contours[i]);
+        if (area < std::max(40.0, total * 0.0002) || area > total * 0.05)
+            continue;
+        cv::RotatedRect box = cv::minAreaRect(contours[i]);
+        float shortSide = std::min(box.size.width, box.size.height);
+        float longSide = std::max(box.size.width, box.size.height);
+        if (shortSide <= 0 || longSide / shortSide > 1.6f || area / box.size.area() < 0.8)
+            continue;
+        candidates.push_back({box.center / scale, static_cast<float>(std::sqrt(area) / scale), box.angle});
+    }
+
+    // Largest first, drop anything centred inside an already kept candidate.
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.side > b.side; });
+    std::vector<Candidate> unique;
+    for (const Candidate& c : candidates) {
+        bool duplicate = std::any_of(unique.begin(), unique.end(), [&](const Candidate& k) {
+            return cv::norm(c.center - k.center) <= 0.5 * k.side;
+        });
+        if (!duplicate)
+            unique.push_back(c);
+    }
+    return unique;
+}
+
+// Keeps the candidates of the most common size (patches of one chart are all alike).
+std::vector<Candidate> dominantSize(const std::vector<Candidate>& candidates) {
+    size_t bestCount = 0;
+    float bestSide = 0;
+    for (const Candidate& c : candidates) {
+        size_t count = std::count_if(candidates.begin(), candidates.end(), [&](const Candidate& o) {
+            return o.side >= 0.7f * c.side && o.side <= 1.4f * c.side;
+        });
+        if (count > bestCount) {
+            bestCount = count;
+            bestSide = c.side;
+        }
+    }
+    std::vector<Candidate> kept;
+    for (const Candidate& c : candidates)
+        if (c.side >= 0.7f * bestSide && c.side <= 1.4f * bestSide)
+            kept.push_back(c);
+    return kept;
+}
+
+float median(std::vector<float> values) {
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+// Breadth-first walk from `seed`, giving each reachable candidate an integer grid
+// cell. Steps are measured relative to the parent, so slow perspective drift in
+// pitch and direction does not accumulate.
+std::map<int, cv::Point> linkGrid(const std::vector<Candidate>& candidates, int seed,
+                                  cv::Point2f u, cv::Point2f v, float pitch) {
+    std::map<int, cv::Point> cellOf;
+    std::map<std::pair<int, int>, int> owner;
+    std::deque<int> queue;
+    cellOf[seed] = cv::Point(0, 0);
+    owner[{0, 0}] = seed;
+    queue.push_back(seed);
+    while (!queue.empty()) {
+        int a = queue.front();
+        queue.pop_front();
+        for (int b = 0; b < static_cast<int>(candidates.size()); b++) {
+            if (cellOf.count(b))
+                continue;
+            cv::Point2f d = candidates[b].center - candidates[a].center;
+            if (cv::norm(d) > 2.5 * pitch)
+                continue;
+            float x = d.dot(u) / pitch, y = d.dot(v) / pitch;
+            int rx = cvRound(x), ry = cvRound(y);
+            if ((rx == 0 && ry == 0) || std::abs(x - rx) > 0.35f || std::abs(y - ry) > 0.35f)
+                continue;
+            cv::Point cell = cellOf[a] + cv::Point(rx, ry);
+            if (owner.count({cell.x, cell.y}))
+                continue;
+            cellOf[b] = cell;
+            owner[{cell.x, cell.y}] = b;
+            queue.push_back(b);
+        }
+    }
+    return cellOf;
+}
+
+// Chart (column, row) -> grid cell for orientation k (quarter turns) and offset.
+cv::Matx33d chartToGrid(int k, int ox, int oy) {
+    switch (k) {
+    case 0: return cv::Matx33d(1, 0, ox, 0, 1, oy, 0, 0, 1);
+    case 1: return cv::Matx33d(0, -1, kChartRows - 1 + ox, 1, 0, oy, 0, 0, 1);
+    case 2: return cv::Matx33d(-1, 0, kChartCols - 1 + ox, 0, -1, kChartRows - 1 + oy, 0, 0, 1);
+    default: return cv::Matx33d(0, 1, ox, -1, 0, kChartCols - 1 + oy, 0, 0, 1);
+    }
+}
+
+std::vector<cv::Point2f> patchQuad(const cv::Matx33d& H, int col, int row, double half) {
+    std::vector<cv::Point2f> quad = {
+        cv::Point2f(static_cast<float>(col - half), static_cast<float>(row - half)),
+        cv::Point2f(static_cast<float>(col + half), static_cast<float>(row - half)),
+        cv::Point2f(static_cast<float>(col + half), static_cast<float>(row + half)),
+        cv::Point2f(static_cast<float>(col - half), static_cast<float>(row + half))};
+    cv::perspectiveTransform(quad, quad, H);
+    return quad;
+}
+
+// Mean colour of every patch; false if any sampled square leaves the image.
+bool samplePatches(const cv::Mat& img, const cv::Matx33d& H, double half, cv::Mat& colors,
+                   std::vector<cv::Point2f>& centers) {
+    colors.create(kPatches, 3, CV_32F);
+    centers.resize(kPatches);
+    const cv::Rect bounds(0, 0, img.cols, img.rows);
+    cv::Mat mask;
+    for (int row = 0; row < kChartRows; row++) {
+        for (int col = 0; col < kChartCols; col++) {
+            std::vector<cv::Point2f> quad = patchQuad(H, col, row, half);
+            cv::Rect box = cv::boundingRect(quad);
+            if ((box & bounds) != box || box.area() == 0)
+                return false;
+
+            std::vector<cv::Point> local;
+            for (const cv::Point2f& p : quad)
+                local.emplace_back(cvRound(p.x) - box.x, cvRound(p.y) - box.y);
+            mask = cv::Mat::zeros(box.size(), CV_8U);
+            cv::fillConvexPoly(mask, local, cv::Scalar(255));
+            cv::Scalar mean = cv::mean(img(box), mask);
+
+            const int index = row * kChartCols + col;
+            float* C = colors.ptr<float>(index);
+            C[0] = static_cast<float>(mean[0]);
+            C[1] = static_cast<float>(mean[1]);
+            C[2] = static_cast<float>(mean[2]);
+            centers[index] = (quad[0] + quad[2]) * 0.5f;
+        }
+    }
+    return true;
+}
+
+// RMS error of the best affine map from measured to reference colours.
+double affineResidual(const cv::Mat& measured, const cv::Mat& ReferenceColor) {
+    cv::Mat A(kPatches, 4, CV_32F, cv::Scalar(1));
+    measured.copyTo(A.colRange(0, 3));
+    cv::Mat X;
+    cv::solve(A, ReferenceColor, X, cv::DECOMP_SVD);
+    cv::Mat error = A * X - ReferenceColor;
+    return std::sqrt(error.dot(error) / error.total());
+}
+
+} // namespace
+
+bool readReferenceColors(const std::string& path, cv::Mat& ReferenceColor) {
+    std::ifstream infile(path);
+    if (!infile) {
+        std::cerr << "Open the reference color file error: " << path << std::endl;
+        return false;
+    }
+    ReferenceColor.create(kPatches, 3, CV_32F);
+    int row = 0;
+    std::string textline;
+    while (getline(infile, textline)) {
+        std::stringstream line(textline);
+        std::string cell;
+        int col = 0;
+        while (getline(line, cell, ',')) {
+            if (cell.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            if (row >= kPatches || col >= 3) {
+                std::cerr << "Too many values in " << path << std::endl;
+                return false;
+            }
+            try {
+                ReferenceColor.at<float>(row, col++) = std::stof(cell);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value '" << cell << "' in " << path << std::endl;
+                return false;
+            }
+        }
+        if (col == 0)
+            continue;
+        if (col != 3) {
+            std::cerr << "Expected 3 values per row in " << path << std::endl;
+            return false;
+        }
+        row++;
+    }
+    if (row != kPatches) {
+        std::cerr << "Expected " << kPatches << " reference colours in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ChartDetection detectColorChart(const cv::Mat& img, const cv::Mat& ReferenceColor, const ChartDetectorOptions& options) {
+    CCM_TRACE_SCOPE("detectColorChart");
+    CV_Assert(img.type() == CV_8UC3);
+    CV_Assert(ReferenceColor.rows == kPatches && ReferenceColor.cols == 3 && ReferenceColor.type() == CV_32F);
+    ChartDetection result;
+
+    std::vector<Candidate> candidates = dominantSize(findCandidates(img, options.maxDetectionSide));
+    if (static_cast<int>(candidates.size()) < options.minPatchesSeen)
+        return result;
+
+    // Grid pitch from nearest-neighbour distances, orientation from the patch rectangles
+    // (angles averaged modulo 90 degrees).
+    const int n = static_cast<int>(candidates.size());
+    std::vector<float> nearest(n, FLT_MAX), sides(n);
+    double c4 = 0, s4 = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++)
+            if (i != j)
+                nearest[i] = std::min(nearest[i], static_cast<float>(cv::norm(candidates[i].center - candidates[j].center)));
+        sides[i] = candidates[i].side;
+        c4 += std::cos(4 * candidates[i].angle * CV_PI / 180);
+        s4 += std::sin(4 * candidates[i].angle * CV_PI / 180);
+    }
+    const float pitch = median(nearest);
+    const float side = median(sides);
+    const double theta = std::atan2(s4, c4) / 4;
+    const cv::Point2f u(static_cast<float>(std::cos(theta)), static_cast<float>(std::sin(theta)));
+    const cv::Point2f v(-u.y, u.x);
+
+    // Seeds with many close neighbours sit inside the chart; keep the largest grid that fits 6x4.
+    std::vector<int> seeds(n);
+    std::vector<int> neighbours(n, 0);
+    for (int i = 0; i < n; i++) {
+        seeds[i] = i;
+        for (int j = 0; j < n; j++)
+            if (i != j && cv::norm(candidates[i].center - candidates[j].center) < 1.5 * pitch)
+                neighbours[i]++;
+    }
+    std::sort(seeds.begin(), seeds.end(), [&](int a, int b) { return neighbours[a] > neighbours[b]; });
+
+    std::map<int, cv::Point> grid;
+    cv::Rect extent;
+    for (int s = 0; s < std::min(n, 5); s++) {
+        std::map<int, cv::Point> linked = linkGrid(candidates, seeds[s], u, v, pitch);
+        std::vector<cv::Point> cells;
+        for (const auto& entry : linked)
+            cells.push_back(entry.second);
+        cv::Rect box = cv::boundingRect(cells);
+        bool fits = (box.width <= kChartCols && box.height <= kChartRows) ||
+                    (box.width <= kChartRows && box.height <= kChartCols);
+        if (fits && linked.size() > grid.size()) {
+            grid = std::move(linked);
+            extent = box;
+        }
+    }
+    if (static_cast<int>(grid.size()) < options.minPatchesSeen)
+        return result;
+
+    std::vector<cv::Point2f> gridPoints, imagePoints;
+    for (const auto& entry : grid) {
+        gridPoints.emplace_back(static_cast<float>(entry.second.x), static_cast<float>(entry.second.y));
+        imagePoints.push_back(candidates[entry.first].center);
+    }
+    cv::Mat H = cv::findHomography(gridPoints, imagePoints, cv::RANSAC, 0.25 * pitch);
+    if (H.empty())
+        return result;
+    const cv::Matx33d gridToImage(H);
+
+    // Try every orientation and every placement of the chart that covers the observed cells.
+    const double half = 0.5 * options.sampleFraction * side / pitch;
+    double bestResidual = DBL_MAX;
+    cv::Mat colors;
+    std::vector<cv::Point2f> centers;
+    for (int k = 0; k < 4; k++) {
+        const int w = k % 2 == 0 ? kChartCols : kChartRows;
+        const int h = k % 2 == 0 ? kChartRows : kChartCols;
+        for (int ox = extent.x + extent.width - w; ox <= extent.x; ox++) {
+            for (int oy = extent.y + extent.height - h; oy <= extent.y; oy++) {
+                cv::Matx33d chartToImage = gridToImage * chartToGrid(k, ox, oy);
+                if (!samplePatches(img, chartToImage, half, colors, centers))
+                    continue;
+                double residual = affineResidual(colors, ReferenceColor);
+                if (residual < bestResidual) {
+                    bestResidual = residual;
+                    result.found = true;
+                    result.patchColors = colors.clone();
+                    result.centers = centers;
+                    result.homography = chartToImage;
+                }
+            }
+        }
+    }
+    result.sampleHalf = half;
+    result.patchesSeen = static_cast<int>(grid.size());
+    result.residual = result.found ? bestResidual : 0;
+    if (result.found && bestResidual > options.maxResidual)
+        result.found = false;   // residual kept for the caller's message
+    return result;
+}
+
+void drawColorChart(cv::Mat& img, const ChartDetection& detection) {
+    if (!detection.found)
+        return;
+    for (int row = 0; row < kChartRows; row++) {
+        for (int col = 0; col < kChartCols; col++) {
+            std::vector<cv::Point2f> quad = patchQuad(detection.homography, col, row, detection.sampleHalf);
+            std::vector<cv::Point> polygon(quad.begin(), quad.end());
+            cv::polylines(img, polygon, true, cv::Scalar(0, 0, 255), 2);
+            const int index = row * kChartCols + col;
+            cv::putText(img, std::to_string(index + 1), detection.centers[index], cv::FONT_HERSHEY_SIMPLEX, 0.4,
+                        cv::Scalar(0, 0, 255), 1);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CHART_DETECT_H
+#define CHART_DETECT_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Automatic 24-patch ColorChecker locator (replaces the interactive ROISelection).
+//
+// 1. Square-ish regions enclosed by colour edges are patch candidates; the
+//    dominant size cluster is kept.
+// 2. Candidates are linked into an integer grid by stepping between neighbours
+//    along the dominant patch orientation, which tolerates rotation, missing
+//    patches (e.g. black on a black frame) and moderate perspective.
+// 3. A homography from grid to image is fitted (RANSAC); every placement of the
+//    6x4 chart on the grid in each of the 4 orientations is sampled and the one
+//    whose patches best match the reference colours (affine least squares) wins.
+//    A best fit above maxResidual is rejected: on a real chart the right
+//    orientation fits far better than the others (about 14 vs 49 on
+//    imgs/original_img.bmp), so a poor best fit means no chart was found.
+
+struct ChartDetectorOptions {
+    int maxDetectionSide = 1000;   // candidates are searched on an image downscaled to this
+    int minPatchesSeen = 12;       // grid cells that must be found directly
+    double sampleFraction = 0.5;   // averaged fraction of each patch side (avoids edges)
+    double maxResidual = 30.0;     // gate on ChartDetection::residual (8-bit units)
+};
+
+struct ChartDetection {
+    bool found = false;
+    cv::Mat patchColors;                  // 24x3 CV_32F BGR means, ReferenceColor.csv order
+    std::vector<cv::Point2f> centers;     // 24 patch centres, same order
+    cv::Matx33d homography;               // chart (column, row) -> image pixels
+    double sampleHalf = 0;                // half side of each averaged square, in chart units
+    int patchesSeen = 0;
+    double residual = 0;                  // RMS of the affine fit to the reference (8-bit units)
+};
+
+// 24x3 CV_32F reference colours (one BGR row per patch). Returns false on errors.
+bool readReferenceColors(const std::string& path, cv::Mat& ReferenceColor);
+
+ChartDetection detectColorChart(const cv::Mat& img, const cv::Mat& ReferenceColor,
+                                const ChartDetectorOptions& options = ChartDetectorOptions());
+
+// Debug overlay: sampled area of every patch with its index.
+void drawColorChart(cv::Mat& img, const ChartDetection& detection);
+
+#endif // CHART_DETECT_H
@@ -0,0 +1,84 @@
+#include "delta_processor.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+DeltaProcessor::DeltaProcessor(FrameOp op, const DeltaOptions& options) : op_(std::move(op)), options_(options) {
+    options_.blockSize = std::max(options_.blockSize, 8);
+    options_.lumaScale = std::clamp(options_.lumaScale, 1, options_.blockSize);
+}
+
+// Floor on both edges: the luma rects of neighbouring blocks tile the luma image
+// without overlap, so updating one block's reference never touches another's.
+cv::Rect DeltaProcessor::lumaRect(const cv::Rect& block) const {
+    const int x0 = block.x * luma_.cols / output_.cols, x1 = block.br().x * luma_.cols / output_.cols;
+    const int y0 = block.y * luma_.rows / output_.rows, y1 = block.br().y * luma_.rows / output_.rows;
+    return cv::Rect(x0, y0, std::max(x1 - x0, 1), std::max(y1 - y0, 1)) & cv::Rect(0, 0, luma_.cols, luma_.rows);
+}
+
+void DeltaProcessor::refresh(const cv::Mat& frame) {
+    CCM_TRACE_SCOPE("DeltaProcessor::refresh");
+    op_(frame, output_);
+    luma_.copyTo(reference_);
+    valid_ = true;
+    sinceRefresh_ = 0;
+    refreshes_++;
+}
+
+void DeltaProcessor::process(const cv::Mat& frame, cv::Mat& dst) {
+    CCM_TRACE_SCOPE("DeltaProcessor::process");
+    CV_Assert(frame.type() == CV_8UC3 && !frame.empty());
+    frames_++;
+    const int B = options_.blockSize, s = options_.lumaScale;
+    const int blocksX = (frame.cols + B - 1) / B, blocksY = (frame.rows + B - 1) / B;
+    blocksTotal_ += uint64_t(blocksX) * blocksY;
+
+    {
+        CCM_TRACE_SCOPE("delta-luma");
+        cv::resize(frame, small_, cv::Size((frame.cols + s - 1) / s, (frame.rows + s - 1) / s), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small_, luma_, cv::COLOR_BGR2GRAY);
+    }
+
+    if (!valid_ || output_.size() != frame.size() || output_.type() != frame.type() ||
+        (options_.refreshEvery > 0 && ++sinceRefresh_ >= static_cast<uint64_t>(options_.refreshEvery))) {
+        refresh(frame);
+        blocksProcessed_ += uint64_t(blocksX) * blocksY;
+        output_.copyTo(dst);
+        return;
+    }
+
+    // Changed blocks, merged into horizontal runs per block row.
+    cv::absdiff(luma_, reference_, difference_);
+    runs_.clear();
+    for (int j = 0; j < blocksY; j++) {
+        const int y = j * B, h = std::min(B, frame.rows - y);
+        int runStart = -1;
+        for (int i = 0; i <= blocksX; i++) {
+            bool changed = false;
+            if (i < blocksX) {
+                double peak = 0;
+                cv::minMaxLoc(difference_(lumaRect(cv::Rect(i * B, y, std::min(B, frame.cols - i * B), h))), nullptr, &peak);
+                changed = peak > options_.threshold;
+            }
+            if (changed && runStart < 0) {
+                runStart = i;
+            } else if (!changed && runStart >= 0) {
+                const int x = runStart * B;
+                runs_.push_back(cv::Rect(x, y, std::min(i * B, frame.cols) - x, h));
+                blocksProcessed_ += i - runStart;
+                runStart = -1;
+            }
+        }
+    }
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(runs_.size())), [&](const cv::Range& range) {
+        thread_local cv::Mat block;
+        for (int r = range.start; r < range.end; r++) {
+            const cv::Rect& run = runs_[r];
+            op_(frame(run), block);
+            block.copyTo(output_(run));
+            const cv::Rect lr = lumaRect(run);
+            luma_(lr).copyTo(reference_(lr));
+        }
+    });
+    output_.copyTo(dst);
+}
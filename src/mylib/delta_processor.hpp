@@ -0,0 +1,55 @@
+#ifndef DELTA_PROCESSOR_H
+#define DELTA_PROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "frame_pipeline.hpp"
+
+struct DeltaOptions {
+    int blockSize = 64;       // block edge in frame pixels
+    int lumaScale = 8;        // change detection runs on luma downscaled by this factor
+    double threshold = 10.0;  // peak |luma difference| (0-255, on the downscaled luma) that marks a block changed
+    int refreshEvery = 120;   // full re-process every n frames; 0 = only on the first frame and invalidate()
+};
+
+// Change-aware wrapper around a pointwise frame op, for static-camera footage.
+// Each frame is downscaled to a small luma image (INTER_AREA, which also averages
+// out sensor noise) and compared block by block with the luma each block was last
+// processed from. Only changed blocks go through `op` again; the rest keep their
+// previous output. Comparing against the last processed luma rather than the
+// previous frame means slow drift still trips the threshold eventually, and the
+// periodic full refresh bounds whatever stays below it.
+// The block test uses the peak difference instead of the block SAD: a small
+// object moving through a 64x64 block barely moves its mean.
+// `op` must be pointwise (its output for a pixel depends only on that pixel) and
+// safe to call concurrently on different blocks; changed blocks of one block row
+// are merged into a single call.
+class DeltaProcessor {
+public:
+    explicit DeltaProcessor(FrameOp op, const DeltaOptions& options = DeltaOptions());
+
+    void process(const cv::Mat& frame, cv::Mat& dst);
+    // Process the next frame in full (e.g. after the op's parameters changed).
+    void invalidate() { valid_ = false; }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t refreshes() const { return refreshes_; }
+    // Fraction of blocks that went through the op, over all frames.
+    double processedFraction() const { return blocksTotal_ ? double(blocksProcessed_) / blocksTotal_ : 0.0; }
+
+private:
+    void refresh(const cv::Mat& frame);
+    cv::Rect lumaRect(const cv::Rect& block) const;
+
+    FrameOp op_;
+    DeltaOptions options_;
+    cv::Mat output_, small_, luma_, reference_, difference_;
+    std::vector<cv::Rect> runs_;
+    bool valid_ = false;
+    uint64_t sinceRefresh_ = 0;
+    uint64_t frames_ = 0, refreshes_ = 0, blocksProcessed_ = 0, blocksTotal_ = 0;
+};
+
+#endif // DELTA_PROCESSOR_H
@@ -0,0 +1,229 @@
+#include "frame_pipeline.hpp"
+#include "alloc_counter.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <exception>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+double toMs(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// Process-wide aggregates across every pipeline run (see metrics.hpp).
+struct PipelineMetrics {
+    LatencyHistogram& decode = metrics().histogram("ccm_stage_latency_seconds", "Per-frame latency of each stage", "stage=\"decode\"");
+    LatencyHistogram& correct = metrics().histogram("ccm_stage_latency_seconds", "Per-frame latency of each stage", "stage=\"correct\"");
+    LatencyHistogram& encode = metrics().histogram("ccm_stage_latency_seconds", "Per-frame latency of each stage", "stage=\"encode\"");
+    Counter& frames = metrics().counter("ccm_frames_processed_total", "Frames corrected and handed to the encoder");
+    Counter& dropped = metrics().counter("ccm_frames_dropped_total", "Decoded frames that never reached the encoder");
+    Gauge& decodedDepth = metrics().gauge("ccm_queue_depth", "Frames waiting in a pipeline ring", "queue=\"decoded\"");
+    Gauge& correctedDepth = metrics().gauge("ccm_queue_depth", "Frames waiting in a pipeline ring", "queue=\"corrected\"");
+};
+
+PipelineMetrics& pipelineMetrics() {
+    static PipelineMetrics instance;
+    return instance;
+}
+
+// Spin briefly, then yield, then sleep: waits are usually a fraction of a frame.
+struct Backoff {
+    int spins = 0;
+    void pause() {
+        if (spins < 64) {
+            spins++;
+        } else if (spins < 128) {
+            spins++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+};
+
+} // namespace
+
+FrameRing::FrameRing(size_t capacity, cv::Size frameSize, int frameType) : slots_(capacity < 2 ? 2 : capacity) {
+    if (frameSize.area() > 0) {
+        for (cv::Mat& slot : slots_)
+            slot.create(frameSize, frameType);
+    }
+}
+
+cv::Mat* FrameRing::beginPush() {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= slots_.size()) {
+        fullWaits_++;
+        Backoff backoff;
+        while (tail - head_.load(std::memory_order_acquire) >= slots_.size()) {
+            if (closed_.load(std::memory_order_acquire))
+                return nullptr;
+            backoff.pause();
+        }
+    }
+    if (closed_.load(std::memory_order_acquire))
+        return nullptr;
+    return &slots_[tail % slots_.size()];
+}
+
+void FrameRing::endPush() {
+    const size_t tail = tail_.load(std::memory_order_relaxed) + 1;
+    tail_.store(tail, std::memory_order_release);
+
+    size_t depth = tail - head_.load(std::memory_order_acquire);
+    pushes_++;
+    depthSum_ += depth;
+    if (depth > maxDepth_)
+        maxDepth_ = depth;
+}
+
+cv::Mat* FrameRing::beginPop() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head) {
+        emptyWaits_++;
+        Backoff backoff;
+        while (tail_.load(std::memory_order_acquire) == head) {
+            if (closed_.load(std::memory_order_acquire) && tail_.load(std::memory_order_acquire) == head)
+                return nullptr;
+            backoff.pause();
+        }
+    }
+    return &slots_[head % slots_.size()];
+}
+
+void FrameRing::endPop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void FrameRing::close() {
+    closed_.store(true, std::memory_order_release);
+}
+
+PipelineStats runFramePipeline(const FrameSource& source, const FrameOp& op, const FrameSink& sink,
+                               const PipelineOptions& options) {
+    FrameRing decoded(options.queueDepth, options.frameSize, options.frameType);
+    FrameRing corrected(options.queueDepth, options.frameSize, options.frameType);
+    PipelineStats stats;
+    const size_t warmupFrames = 2 * decoded.capacity();
+    const size_t allocationsAtStart = matAllocationCount();
+    size_t allocationsAtWarmup = 0;
+    std::exception_ptr decodeError, encodeError, correctError;
+    PipelineMetrics& m = pipelineMetrics();
+    size_t decodedFrames = 0, encodedFrames = 0;
+    const Clock::time_point start = Clock::now();
+
+    std::thread decoder([&] {
+        CCM_TRACE_THREAD("decoder");
+        try {
+            while (cv::Mat* slot = decoded.beginPush()) {
+                CCM_TRACE_FRAME("decode", decodedFrames);
+                Clock::time_point t = Clock::now();
+                bool ok = source(*slot);
+                Clock::duration d = Clock::now() - t;
+                stats.decodeMs += toMs(d);
+                if (!ok)
+                    break;
+                m.decode.record(d);
+                decoded.endPush();
+                decodedFrames++;
+                m.decodedDepth.set(static_cast<int64_t>(decoded.depth()));
+            }
+        } catch (...) {
+            decodeError = std::current_exception();
+        }
+        decoded.close();
+    });
+
+    std::thread encoder([&] {
+        CCM_TRACE_THREAD("encoder");
+        try {
+            while (cv::Mat* slot = corrected.beginPop()) {
+                CCM_TRACE_FRAME("encode", encodedFrames);
+                Clock::time_point t = Clock::now();
+                sink(*slot);
+                Clock::duration d = Clock::now() - t;
+                stats.encodeMs += toMs(d);
+                m.encode.record(d);
+                corrected.endPop();
+                encodedFrames++;
+            }
+        } catch (...) {
+            encodeError = std::current_exception();
+            corrected.close();
+        }
+    });
+
+    try {
+        while (cv::Mat* src = decoded.beginPop()) {
+            cv::Mat* dst = corrected.beginPush();
+            if (!dst)
+                break;   // encoder failed
+            Clock::time_point t = Clock::now();
+            {
+                CCM_TRACE_FRAME("correct", stats.frames);
+                op(*src, *dst);
+            }
+            Clock::duration d = Clock::now() - t;
+            stats.correctMs += toMs(d);
+            m.correct.record(d);
+            m.frames.add();
+            decoded.endPop();
+            corrected.endPush();
+            m.correctedDepth.set(static_cast<int64_t>(corrected.depth()));
+            if (++stats.frames == warmupFrames)
+                allocationsAtWarmup = matAllocationCount();
+        }
+    } catch (...) {
+        correctError = std::current_exception();
+    }
+    decoded.close();     // stop the decoder if we bailed out early
+    corrected.close();   // end of stream for the encoder
+    decoder.join();
+    encoder.join();
+    m.dropped.add(decodedFrames - encodedFrames);
+    m.decodedDepth.set(0);
+    m.correctedDepth.set(0);
+
+    stats.wallMs = elapsedMs(start);
+    stats.matAllocations = matAllocationCount() - allocationsAtStart;
+    if (stats.frames > warmupFrames) {
+        stats.steadyFrames = stats.frames - warmupFrames;
+        stats.steadyMatAllocations = matAllocationCount() - allocationsAtWarmup;
+    }
+    stats.decodedMaxDepth = decoded.maxDepth();
+    stats.decodedAvgDepth = decoded.averageDepth();
+    stats.correctedMaxDepth = corrected.maxDepth();
+    stats.correctedAvgDepth = corrected.averageDepth();
+    stats.decoderBlocked = decoded.fullWaits();
+    stats.correctorStarved = decoded.emptyWaits();
+    stats.correctorBlocked = corrected.fullWaits();
+    stats.encoderStarved = corrected.emptyWaits();
+
+    if (decodeError)
+        std::rethrow_exception(decodeError);
+    if (correctError)
+        std::rethrow_exception(correctError);
+    if (encodeError)
+        std::rethrow_exception(encodeError);
+    return stats;
+}
+
+void printPipelineStats(std::ostream& os, const PipelineStats& stats) {
+    os << "Frames: " << stats.frames << ", wall " << stats.wallMs << " ms"
+       << " (decode " << stats.decodeMs << " ms, correct " << stats.correctMs
+       << " ms, encode " << stats.encodeMs << " ms)" << std::endl;
+    os << "Queue depth decoded: avg " << stats.decodedAvgDepth << " max " << stats.decodedMaxDepth
+       << ", corrected: avg " << stats.correctedAvgDepth << " max " << stats.correctedMaxDepth << std::endl;
+    os << "Waits: decoder blocked " << stats.decoderBlocked << ", corrector starved " << stats.correctorStarved
+       << ", corrector blocked " << stats.correctorBlocked << ", encoder starved " << stats.encoderStarved << std::endl;
+    os << "Mat allocations: " << stats.matAllocations << " total, " << stats.steadyMatAllocations
+       << " over " << stats.steadyFrames << " steady-state frames" << std::endl;
+}
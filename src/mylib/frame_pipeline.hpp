@@ -0,0 +1,79 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring of preallocated frames.
+// Lock-free: the producer owns tail_, the consumer owns head_. A full ring
+// blocks the producer (backpressure), an empty one blocks the consumer.
+class FrameRing {
+public:
+    // Slots are preallocated when frameSize is given, so producers that write with
+    // Mat::create()/copyTo() of the same geometry never allocate.
+    explicit FrameRing(size_t capacity, cv::Size frameSize = cv::Size(), int frameType = CV_8UC3);
+
+    // Producer side. Returns nullptr once the ring has been closed.
+    cv::Mat* beginPush();
+    void endPush();
+
+    // Consumer side. Returns nullptr when the ring is closed and drained.
+    cv::Mat* beginPop();
+    void endPop();
+
+    // Producer: no more frames. Consumer: abort, unblocks a waiting producer.
+    void close();
+
+    size_t capacity() const { return slots_.size(); }
+    size_t depth() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+    // Queue-depth counters, sampled on every push.
+    size_t pushes() const { return pushes_; }
+    size_t maxDepth() const { return maxDepth_; }
+    double averageDepth() const { return pushes_ ? static_cast<double>(depthSum_) / pushes_ : 0.0; }
+    size_t fullWaits() const { return fullWaits_; }     // producer found the ring full
+    size_t emptyWaits() const { return emptyWaits_; }   // consumer found the ring empty
+
+private:
+    std::vector<cv::Mat> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::atomic<bool> closed_{false};
+
+    size_t pushes_ = 0, depthSum_ = 0, maxDepth_ = 0, fullWaits_ = 0;   // producer-owned
+    size_t emptyWaits_ = 0;                                             // consumer-owned
+};
+
+using FrameSource = std::function<bool(cv::Mat& frame)>;                 // false at end of stream
+using FrameOp = std::function<void(const cv::Mat& src, cv::Mat& dst)>;
+using FrameSink = std::function<void(const cv::Mat& frame)>;
+
+struct PipelineOptions {
+    size_t queueDepth = 4;   // frames per ring
+    cv::Size frameSize;      // preallocate every ring slot when set
+    int frameType = CV_8UC3;
+};
+
+struct PipelineStats {
+    size_t frames = 0;
+    double wallMs = 0, decodeMs = 0, correctMs = 0, encodeMs = 0;   // busy time per stage
+    size_t decodedMaxDepth = 0, correctedMaxDepth = 0;
+    double decodedAvgDepth = 0, correctedAvgDepth = 0;
+    size_t decoderBlocked = 0, correctorStarved = 0, correctorBlocked = 0, encoderStarved = 0;
+    // cv::Mat allocations (see alloc_counter.hpp); steady state excludes the first
+    // 2 * queueDepth frames, after which every ring slot has been filled once.
+    size_t matAllocations = 0, steadyFrames = 0, steadyMatAllocations = 0;
+};
+
+// Three-stage pipeline: decoder thread -> correction (calling thread) -> encoder
+// thread, connected by two FrameRings. Exceptions from any stage stop the
+// pipeline and are rethrown here.
+PipelineStats runFramePipeline(const FrameSource& source, const FrameOp& op, const FrameSink& sink,
+                               const PipelineOptions& options = PipelineOptions());
+
+void printPipelineStats(std::ostream& os, const PipelineStats& stats);
+
+#endif // FRAME_PIPELINE_H
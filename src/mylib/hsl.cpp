@@ -1,6 +1,10 @@
 #include "hsl.hpp"
+#include "selective_color.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 using namespace cv;
 
@@ -66,19 +70,7 @@ cv::Mat adjust_yellow(const cv::Mat& img, double hue, double saturation, double
         return cv::Mat();
     }
 
-    cv::Mat result = img.clone();
-    for (int y = 0; y < img.rows; y++) {
-        for (int x = 0; x < img.cols; x++) {
-            cv::Vec3b pixel = img.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-
-            hsl.h = std::fmod(hsl.h + hue, 360.0);
-            hsl.s = std::clamp(hsl.s * (1 + saturation / 100), 0.0, 100.0);
-            hsl.l = std::clamp(hsl.l * (1 + lightness / 100), 0.0, 100.0);
-
-            result.at<cv::Vec3b>(y, x) = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-        }
-    }
+    cv::Mat result = adjust_hsl_yellow_frame(img, hue, saturation, lightness);
 
     cv::imwrite(output_path, result);
     std::cout << "Adjusted Yellow image saved at: " << output_path << std::endl;
@@ -91,62 +83,56 @@ cv::Mat adjust_green(const cv::Mat& img, double hue, double saturation, double l
         return cv::Mat();
     }
 
-    cv::Mat result = img.clone();
-    for (int y = 0; y < img.rows; y++) {
-        for (int x = 0; x < img.cols; x++) {
-            cv::Vec3b pixel = img.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-
-            // Điều chỉnh màu xanh lá cây (khoảng 60-180 độ trong hệ HSL)
-            if (hsl.h >= 60 && hsl.h <= 180) {
-                hsl.h = std::clamp(hsl.h + hue, 60.0, 180.0);
-                hsl.s = std::clamp(hsl.s * (1 + saturation / 100.0), 0.0, 100.0);
-                hsl.l = std::clamp(hsl.l * (1 + lightness / 100.0), 0.0, 100.0);
-            }
-
-            result.at<cv::Vec3b>(y, x) = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-        }
-    }
+    cv::Mat result = adjust_hsl_green_frame(img, hue, saturation, lightness);
 
     cv::imwrite(output_path, result);
     std::cout << "Adjusted Green image saved at: " << output_path << std::endl;
     return result;
 }
 
-cv::Mat adjust_hsl_yellow_frame(const cv::Mat& frame, double hue, double saturation, double lightness) {
-    cv::Mat result = frame.clone();
-    for (int y = 0; y < frame.rows; y++) {
-        for (int x = 0; x < frame.cols; x++) {
-            cv::Vec3b pixel = frame.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
+namespace {
+
+// The compiled tables of the last few bands used on this thread. The frame and
+// strip paths call the passes below once per frame or strip with the same values,
+// so the tables are built once per parameter set instead of on every call.
+const SelectiveColor& cachedSelectiveColor(const HueBand& band) {
+    thread_local std::vector<std::pair<HueBand, SelectiveColor>> cache;
+    for (const auto& entry : cache) {
+        const HueBand& b = entry.first;
+        if (b.hueStart == band.hueStart && b.hueEnd == band.hueEnd && b.feather == band.feather &&
+            b.hue == band.hue && b.saturation == band.saturation && b.lightness == band.lightness)
+            return entry.second;
+    }
+    if (cache.size() >= 4)   // yellow and green alternate; keep a little slack
+        cache.erase(cache.begin());
+    cache.emplace_back(band, SelectiveColor({band}));
+    return cache.back().second;
+}
 
-            hsl.h = std::fmod(hsl.h + hue, 360.0);
-            hsl.s = std::clamp(hsl.s * (1 + saturation / 100), 0.0, 100.0);
-            hsl.l = std::clamp(hsl.l * (1 + lightness / 100), 0.0, 100.0);
+} // namespace
 
-            result.at<cv::Vec3b>(y, x) = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-        }
-    }
+// Both passes are single-band cases of SelectiveColor.
+// Yellow: every hue, including neutral pixels (historical behaviour).
+void adjust_hsl_yellow_frame(const cv::Mat& frame, cv::Mat& result, double hue, double saturation, double lightness) {
+    CCM_TRACE_SCOPE("adjust_hsl_yellow_frame");
+    cachedSelectiveColor(HueBand{0, 360, 0, hue, saturation, lightness}).apply(frame, result);
+}
+
+// Green: khoảng 60-180 độ trong hệ HSL. The shifted hue is no longer clamped to the band.
+void adjust_hsl_green_frame(const cv::Mat& frame, cv::Mat& result, double hue, double saturation, double lightness) {
+    CCM_TRACE_SCOPE("adjust_hsl_green_frame");
+    cachedSelectiveColor(HueBand{60, 180, 0, hue, saturation, lightness}).apply(frame, result);
+}
+
+cv::Mat adjust_hsl_yellow_frame(const cv::Mat& frame, double hue, double saturation, double lightness) {
+    cv::Mat result;
+    adjust_hsl_yellow_frame(frame, result, hue, saturation, lightness);
     return result;
 }
 
 cv::Mat adjust_hsl_green_frame(const cv::Mat& frame, double hue, double saturation, double lightness) {
-    cv::Mat result = frame.clone();
-    for (int y = 0; y < frame.rows; y++) {
-        for (int x = 0; x < frame.cols; x++) {
-            cv::Vec3b pixel = frame.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-
-            // Điều chỉnh màu xanh lá cây (khoảng 60-180 độ trong hệ HSL)
-            if (hsl.h >= 60 && hsl.h <= 180) {
-                hsl.h = std::clamp(hsl.h + hue, 60.0, 180.0);
-                hsl.s = std::clamp(hsl.s * (1 + saturation / 100.0), 0.0, 100.0);
-                hsl.l = std::clamp(hsl.l * (1 + lightness / 100.0), 0.0, 100.0);
-            }
-
-            result.at<cv::Vec3b>(y, x) = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-        }
-    }
+    cv::Mat result;
+    adjust_hsl_green_frame(frame, result, hue, saturation, lightness);
     return result;
 }
 
@@ -14,5 +14,8 @@ cv::Mat adjust_yellow(const cv::Mat& img, double hue, double saturation, double
 cv::Mat adjust_green(const cv::Mat& img, double hue, double saturation, double lightness, const std::string& output_path);
 cv::Mat adjust_hsl_yellow_frame(const cv::Mat& frame, double hue, double saturation, double lightness);
 cv::Mat adjust_hsl_green_frame(const cv::Mat& frame, double hue, double saturation, double lightness);
+// Write into a caller-owned buffer (reused when size/type match); result may alias frame.
+void adjust_hsl_yellow_frame(const cv::Mat& frame, cv::Mat& result, double hue, double saturation, double lightness);
+void adjust_hsl_green_frame(const cv::Mat& frame, cv::Mat& result, double hue, double saturation, double lightness);
 
 #endif // HSL_H
\ No newline at end of file
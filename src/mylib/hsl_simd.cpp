@@ -0,0 +1,162 @@
+#include "hsl_simd.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Scalar forms of the lane math below; used for the row tails.
+inline void bgrToHsl(float b, float g, float r, float& H, float& S, float& L) {
+    const float cmax = std::max(std::max(b, g), r), cmin = std::min(std::min(b, g), r);
+    const float d = cmax - cmin, sum = cmax + cmin;
+    L = sum * (100.0f / 510.0f);
+    if (d <= 0) {
+        H = S = 0;
+        return;
+    }
+    const float denom = sum <= 255.0f ? sum : 510.0f - sum;
+    S = d / denom * 100.0f;
+    const float num = cmax == r ? g - b : (cmax == g ? b - r + 2 * d : r - g + 4 * d);
+    const float h = num * (60.0f / d);
+    H = h < 0 ? h + 360.0f : h;
+}
+
+// p + (q - p) * clamp(min(x, 4 - x), 0, 1) is hue_to_rgb() with t = x / 6 folded
+// into one expression: rising edge, plateau at q, falling edge, floor at p.
+inline float hueChannel(float x, float p, float qp) {
+    x = x < 0 ? x + 6.0f : x;
+    x = x >= 6.0f ? x - 6.0f : x;
+    const float w = std::min(std::max(std::min(x, 4.0f - x), 0.0f), 1.0f);
+    return (p + qp * w) * 255.0f;
+}
+
+inline void hslToBgr(float H, float S, float L, uchar* bgr) {
+    const float s = S * 0.01f, l = L * 0.01f;
+    const float q = l < 0.5f ? l + l * s : l + s - l * s;
+    const float p = 2 * l - q;
+    const float x = (H - 360.0f * std::floor(H * (1.0f / 360.0f))) * (1.0f / 60.0f);
+    bgr[0] = cv::saturate_cast<uchar>(static_cast<int>(hueChannel(x - 2, p, q - p)));
+    bgr[1] = cv::saturate_cast<uchar>(static_cast<int>(hueChannel(x, p, q - p)));
+    bgr[2] = cv::saturate_cast<uchar>(static_cast<int>(hueChannel(x + 2, p, q - p)));
+}
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+// Function-style intrinsics and no arrays of vector types, so the scalable
+// backends (RVV, SVE), whose vectors are sizeless, build this as well.
+inline void expandToFloat(const cv::v_uint8& v, cv::v_float32& f0, cv::v_float32& f1, cv::v_float32& f2,
+                          cv::v_float32& f3) {
+    cv::v_uint16 lo, hi;
+    cv::v_expand(v, lo, hi);
+    cv::v_uint32 a, b;
+    cv::v_expand(lo, a, b);
+    f0 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(a));
+    f1 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(b));
+    cv::v_expand(hi, a, b);
+    f2 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(a));
+    f3 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(b));
+}
+
+inline cv::v_uint8 packToU8(const cv::v_float32& f0, const cv::v_float32& f1, const cv::v_float32& f2,
+                            const cv::v_float32& f3) {
+    // Truncation, like the Vec3b conversion in hsl_to_rgb().
+    return cv::v_pack_u(cv::v_pack(cv::v_trunc(f0), cv::v_trunc(f1)), cv::v_pack(cv::v_trunc(f2), cv::v_trunc(f3)));
+}
+
+inline void bgrToHslLanes(const cv::v_float32& b, const cv::v_float32& g, const cv::v_float32& r,
+                          float* H, float* S, float* L) {
+    using namespace cv;
+    const v_float32 zero = v_setzero_f32(), one = v_setall_f32(1.0f);
+    const v_float32 cmax = v_max(v_max(b, g), r), cmin = v_min(v_min(b, g), r);
+    const v_float32 d = v_sub(cmax, cmin), sum = v_add(cmax, cmin);
+    v_store(L, v_mul(sum, v_setall_f32(100.0f / 510.0f)));
+
+    // Grey pixels (d == 0) divide by 1 and are then zeroed.
+    const v_float32 chroma = v_gt(d, zero);
+    const v_float32 denom = v_select(v_le(sum, v_setall_f32(255.0f)), sum, v_sub(v_setall_f32(510.0f), sum));
+    v_store(S, v_select(chroma, v_mul(v_div(d, v_select(chroma, denom, one)), v_setall_f32(100.0f)), zero));
+
+    const v_float32 num = v_select(v_eq(cmax, r), v_sub(g, b),
+                                   v_select(v_eq(cmax, g), v_add(v_sub(b, r), v_add(d, d)),
+                                            v_add(v_sub(r, g), v_mul(d, v_setall_f32(4.0f)))));
+    const v_float32 h = v_select(chroma, v_mul(num, v_div(v_setall_f32(60.0f), v_select(chroma, d, one))), zero);
+    v_store(H, v_select(v_lt(h, zero), v_add(h, v_setall_f32(360.0f)), h));
+}
+
+inline cv::v_float32 hueChannelLanes(cv::v_float32 x, const cv::v_float32& p, const cv::v_float32& qp) {
+    using namespace cv;
+    const v_float32 zero = v_setzero_f32(), six = v_setall_f32(6.0f);
+    x = v_select(v_lt(x, zero), v_add(x, six), x);
+    x = v_select(v_ge(x, six), v_sub(x, six), x);
+    const v_float32 w = v_min(v_max(v_min(x, v_sub(v_setall_f32(4.0f), x)), zero), v_setall_f32(1.0f));
+    return v_mul(v_add(p, v_mul(qp, w)), v_setall_f32(255.0f));
+}
+
+inline void hslToBgrLanes(const float* H, const float* S, const float* L,
+                          cv::v_float32& b, cv::v_float32& g, cv::v_float32& r) {
+    using namespace cv;
+    const v_float32 hundredth = v_setall_f32(0.01f), half = v_setall_f32(0.5f);
+    const v_float32 h = vx_load(H), s = v_mul(vx_load(S), hundredth), l = v_mul(vx_load(L), hundredth);
+    const v_float32 ls = v_mul(l, s);
+    const v_float32 q = v_select(v_lt(l, half), v_add(l, ls), v_sub(v_add(l, s), ls));
+    const v_float32 p = v_sub(v_add(l, l), q), qp = v_sub(q, p);
+    const v_float32 turns = v_cvt_f32(v_floor(v_mul(h, v_setall_f32(1.0f / 360.0f))));
+    const v_float32 x = v_mul(v_sub(h, v_mul(turns, v_setall_f32(360.0f))), v_setall_f32(1.0f / 60.0f));
+    const v_float32 two = v_setall_f32(2.0f);
+    b = hueChannelLanes(v_sub(x, two), p, qp);
+    g = hueChannelLanes(x, p, qp);
+    r = hueChannelLanes(v_add(x, two), p, qp);
+}
+
+int bgrRowToHslSimd(const uchar* bgr, float* H, float* S, float* L, int width) {
+    const int VW = cv::VTraits<cv::v_uint8>::vlanes(), FW = cv::VTraits<cv::v_float32>::vlanes();
+    int x = 0;
+    for (; x <= width - VW; x += VW) {
+        cv::v_uint8 b, g, r;
+        cv::v_load_deinterleave(bgr + x * 3, b, g, r);
+        cv::v_float32 b0, b1, b2, b3, g0, g1, g2, g3, r0, r1, r2, r3;
+        expandToFloat(b, b0, b1, b2, b3);
+        expandToFloat(g, g0, g1, g2, g3);
+        expandToFloat(r, r0, r1, r2, r3);
+        bgrToHslLanes(b0, g0, r0, H + x, S + x, L + x);
+        bgrToHslLanes(b1, g1, r1, H + x + FW, S + x + FW, L + x + FW);
+        bgrToHslLanes(b2, g2, r2, H + x + 2 * FW, S + x + 2 * FW, L + x + 2 * FW);
+        bgrToHslLanes(b3, g3, r3, H + x + 3 * FW, S + x + 3 * FW, L + x + 3 * FW);
+    }
+    return x;
+}
+
+int hslRowToBgrSimd(const float* H, const float* S, const float* L, uchar* bgr, int width) {
+    const int VW = cv::VTraits<cv::v_uint8>::vlanes(), FW = cv::VTraits<cv::v_float32>::vlanes();
+    int x = 0;
+    for (; x <= width - VW; x += VW) {
+        cv::v_float32 b0, b1, b2, b3, g0, g1, g2, g3, r0, r1, r2, r3;
+        hslToBgrLanes(H + x, S + x, L + x, b0, g0, r0);
+        hslToBgrLanes(H + x + FW, S + x + FW, L + x + FW, b1, g1, r1);
+        hslToBgrLanes(H + x + 2 * FW, S + x + 2 * FW, L + x + 2 * FW, b2, g2, r2);
+        hslToBgrLanes(H + x + 3 * FW, S + x + 3 * FW, L + x + 3 * FW, b3, g3, r3);
+        cv::v_store_interleave(bgr + x * 3, packToU8(b0, b1, b2, b3), packToU8(g0, g1, g2, g3),
+                               packToU8(r0, r1, r2, r3));
+    }
+    return x;
+}
+#endif
+
+} // namespace
+
+void bgrRowToHsl(const uchar* bgr, float* H, float* S, float* L, int width) {
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    x = bgrRowToHslSimd(bgr, H, S, L, width);
+#endif
+    for (; x < width; x++)
+        bgrToHsl(bgr[x * 3], bgr[x * 3 + 1], bgr[x * 3 + 2], H[x], S[x], L[x]);
+}
+
+void hslRowToBgr(const float* H, const float* S, const float* L, uchar* bgr, int width) {
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    x = hslRowToBgrSimd(H, S, L, bgr, width);
+#endif
+    for (; x < width; x++)
+        hslToBgr(H[x], S[x], L[x], bgr + x * 3);
+}
@@ -0,0 +1,15 @@
+#ifndef HSL_SIMD_H
+#define HSL_SIMD_H
+
+#include <opencv2/core.hpp>
+
+// Row kernels between interleaved 8-bit BGR and float H, S, L planes
+// (H in [0, 360), S and L in [0, 100], as rgb_to_hsl() returns them).
+// Both directions are branchless select-based math over v_float32 lanes with a
+// scalar tail using the same formulas; results stay within one 8-bit code of
+// rgb_to_hsl()/hsl_to_rgb().
+void bgrRowToHsl(const uchar* bgr, float* h, float* s, float* l, int width);
+// H may be any value (it is wrapped), S and L must already be clamped to [0, 100].
+void hslRowToBgr(const float* h, const float* s, const float* l, uchar* bgr, int width);
+
+#endif // HSL_SIMD_H
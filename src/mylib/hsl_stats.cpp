@@ -0,0 +1,181 @@
+#include "hsl_stats.hpp"
+#include "hsl_simd.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+const int kHueBins = 360, kPercentBins = 200;
+
+// Per-band sums of x - shift, with the band's first value as the shift: cancellation
+// stays small even for H around 300 degrees, and there is no division per pixel.
+struct ShiftedSums {
+    double shift = 0, sum = 0, sqSum = 0;
+    uint64_t count = 0;
+
+    void add(double x) {
+        if (count == 0)
+            shift = x;
+        const double d = x - shift;
+        sum += d;
+        sqSum += d * d;
+        count++;
+    }
+
+    RunningStats stats() const {
+        RunningStats s;
+        if (count == 0)
+            return s;
+        s.count = count;
+        s.mean = shift + sum / count;
+        s.m2 = std::max(0.0, sqSum - sum * sum / count);
+        return s;
+    }
+};
+
+} // namespace
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    const double n = static_cast<double>(count + other.count);
+    const double delta = other.mean - mean;
+    mean += delta * other.count / n;
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / n);
+    count += other.count;
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+int FixedHistogram::binOf(double x) const {
+    const int n = static_cast<int>(bins.size());
+    const int bin = static_cast<int>((x - lo) / (hi - lo) * n);
+    return std::clamp(bin, 0, n - 1);
+}
+
+uint64_t FixedHistogram::total() const {
+    uint64_t sum = 0;
+    for (uint64_t b : bins)
+        sum += b;
+    return sum;
+}
+
+double FixedHistogram::percentile(double p) const {
+    const uint64_t n = total();
+    if (n == 0)
+        return lo;
+    const double target = std::clamp(p, 0.0, 1.0) * n;
+    const double width = (hi - lo) / bins.size();
+    double below = 0;
+    for (size_t i = 0; i < bins.size(); i++) {
+        if (bins[i] > 0 && below + bins[i] >= target)
+            return lo + width * (i + (target - below) / bins[i]);
+        below += bins[i];
+    }
+    return hi;
+}
+
+HslStats computeHslStats(const cv::Mat& img, const HslStatsOptions& options) {
+    CCM_TRACE_SCOPE("computeHslStats");
+    CV_Assert(img.type() == CV_8UC3);
+    const int step = std::max(options.sampleStep, 1);
+
+    HslStats stats;
+    stats.histogram = {FixedHistogram(0, 360, kHueBins), FixedHistogram(0, 100, kPercentBins),
+                       FixedHistogram(0, 100, kPercentBins)};
+    std::vector<std::array<RunningStats, 3>> partials(rowBandCount(img.rows));
+    std::mutex histogramMutex;
+
+    parallelRowBands(img.rows, [&](int band, int rowStart, int rowEnd) {
+        // With step > 1 the sampled pixels of a row are gathered first, so only
+        // they go through the conversion.
+        const int samples = (img.cols + step - 1) / step;
+        thread_local std::vector<float> planes;
+        thread_local std::vector<uchar> gathered;
+        planes.resize(size_t(samples) * 3);
+        if (step > 1)
+            gathered.resize(size_t(samples) * 3);
+        float* hsl[3] = {planes.data(), planes.data() + samples, planes.data() + 2 * samples};
+        ShiftedSums sums[3];
+        std::vector<uint32_t> counts[3];
+        if (options.histograms) {
+            for (int c = 0; c < 3; c++)
+                counts[c].assign(stats.histogram[c].bins.size(), 0);
+        }
+        for (int y = (rowStart + step - 1) / step * step; y < rowEnd; y += step) {
+            const uchar* row = img.ptr<uchar>(y);
+            if (step > 1) {
+                for (int i = 0; i < samples; i++) {
+                    const uchar* px = row + size_t(i) * step * 3;
+                    gathered[i * 3] = px[0];
+                    gathered[i * 3 + 1] = px[1];
+                    gathered[i * 3 + 2] = px[2];
+                }
+                row = gathered.data();
+            }
+            bgrRowToHsl(row, hsl[0], hsl[1], hsl[2], samples);
+            for (int x = 0; x < samples; x++) {
+                for (int c = 0; c < 3; c++) {
+                    const double v = hsl[c][x];
+                    sums[c].add(v);
+                    if (options.histograms)
+                        counts[c][stats.histogram[c].binOf(v)]++;
+                }
+            }
+        }
+        for (int c = 0; c < 3; c++)
+            partials[band][c] = sums[c].stats();
+        if (options.histograms) {
+            // Integer counts: the merge order does not affect the result.
+            std::lock_guard<std::mutex> lock(histogramMutex);
+            for (int c = 0; c < 3; c++)
+                for (size_t i = 0; i < counts[c].size(); i++)
+                    stats.histogram[c].bins[i] += counts[c][i];
+        }
+    });
+
+    for (const auto& partial : partials)
+        for (int c = 0; c < 3; c++)
+            stats.channel[c].merge(partial[c]);
+    return stats;
+}
+
+// Hàm mới để xác định các điều chỉnh HSL dựa trên thống kê
+void determineHSLAdjustments(const std::vector<double>& meanHSL, const std::vector<double>& stdDevHSL,
+                             int& hAdjust, int& sAdjust, int& lAdjust) {
+    // Hue: Thường không điều chỉnh tự động
+    hAdjust = 0;
+
+    // Saturation: Điều chỉnh để đưa về mức trung bình nếu quá cao hoặc quá thấp
+    if (meanHSL[1] < 30) {
+        sAdjust = std::min(50, int((30 - meanHSL[1]) / 2));
+    } else if (meanHSL[1] > 70) {
+        sAdjust = std::max(-50, int((70 - meanHSL[1]) / 2));
+    } else {
+        sAdjust = 0;
+    }
+
+    // Lightness: Điều chỉnh để đưa về mức trung bình nếu quá tối hoặc quá sáng
+    if (meanHSL[2] < 40) {
+        lAdjust = std::min(30, int((40 - meanHSL[2]) / 2));
+    } else if (meanHSL[2] > 60) {
+        lAdjust = std::max(-30, int((60 - meanHSL[2]) / 2));
+    } else {
+        lAdjust = 0;
+    }
+}
+
+void determineHSLAdjustments(const HslStats& stats, int& hAdjust, int& sAdjust, int& lAdjust) {
+    std::vector<double> medianHSL = {stats.percentile(0, 0.5), stats.percentile(1, 0.5), stats.percentile(2, 0.5)};
+    std::vector<double> stdDevHSL = {stats.stddev(0), stats.stddev(1), stats.stddev(2)};
+    determineHSLAdjustments(medianHSL, stdDevHSL, hAdjust, sAdjust, lAdjust);
+}
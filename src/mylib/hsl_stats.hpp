@@ -0,0 +1,66 @@
+#ifndef HSL_STATS_H
+#define HSL_STATS_H
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Summary statistics of one value: count, mean and sum of squared deviations.
+// merge() combines two partial results exactly (Chan et al.), so partials can be
+// computed independently per row band and folded together at the end.
+struct RunningStats {
+    uint64_t count = 0;
+    double mean = 0, m2 = 0;
+
+    void merge(const RunningStats& other);
+    double variance() const { return count ? m2 / count : 0.0; }   // population variance
+    double stddev() const;
+};
+
+// Fixed-bin histogram over [lo, hi); values outside are clamped to the end bins.
+struct FixedHistogram {
+    double lo = 0, hi = 1;
+    std::vector<uint64_t> bins;
+
+    FixedHistogram() = default;
+    FixedHistogram(double lo, double hi, int binCount) : lo(lo), hi(hi), bins(binCount, 0) {}
+
+    int binOf(double x) const;
+    uint64_t total() const;
+    // p in [0, 1]; linear within the bin, so the error is below one bin width.
+    double percentile(double p) const;
+};
+
+struct HslStatsOptions {
+    int sampleStep = 1;       // use every n-th pixel of every n-th row
+    bool histograms = true;   // needed for percentile()
+};
+
+// H in [0, 360), S and L in [0, 100], as rgb_to_hsl() returns them.
+struct HslStats {
+    std::array<RunningStats, 3> channel;       // 0 = H, 1 = S, 2 = L
+    std::array<FixedHistogram, 3> histogram;   // 1 degree for H, 0.5 for S and L
+
+    uint64_t count() const { return channel[0].count; }
+    double mean(int c) const { return channel[c].mean; }
+    double stddev(int c) const { return channel[c].stddev(); }
+    double percentile(int c, double p) const { return histogram[c].percentile(p); }
+};
+
+// One parallel pass over a CV_8UC3 BGR image, in memory independent of its size:
+// each row band accumulates shifted sums (no division per pixel), turns them into a
+// RunningStats at the end of the band, and adds its integer bin counts to the shared
+// histograms. The band results are merged in band order, so the result does not
+// depend on the thread count.
+HslStats computeHslStats(const cv::Mat& img, const HslStatsOptions& options = HslStatsOptions());
+
+// Auto-HSL rule: pull saturation towards [30, 70] and lightness towards [40, 60]
+// (values indexed H, S, L); hue is left alone.
+void determineHSLAdjustments(const std::vector<double>& meanHSL, const std::vector<double>& stdDevHSL,
+                             int& hAdjust, int& sAdjust, int& lAdjust);
+// Same rule on the S/L medians: a few blown highlights or a dark border no longer
+// drag the decision the way they drag the means.
+void determineHSLAdjustments(const HslStats& stats, int& hAdjust, int& sAdjust, int& lAdjust);
+
+#endif // HSL_STATS_H
@@ -0,0 +1,105 @@
+#include "image_ops.hpp"
+#include "ccm_kernel.hpp"
+#include "trace.hpp"
+#include <cmath>
+
+void applyColorCorrection(const cv::Mat& src, cv::Mat& dst, const cv::Mat& ColorMatrix, double alpha) {
+    CCM_TRACE_SCOPE("applyColorCorrection");
+    applyCCM(src, dst, ColorMatrix);
+    // alpha < 1.0 giam do sang, > 1.0 tang do sang
+    CCM_TRACE_SCOPE("convertTo");
+    dst.convertTo(dst, -1, alpha, 0);
+}
+
+cv::Mat applyColorCorrection(const cv::Mat& img, const cv::Mat& ColorMatrix) {
+    cv::Mat Dst;
+    applyColorCorrection(img, Dst, ColorMatrix);
+    return Dst;
+}
+
+void applyColorCorrection(const cv::Mat& src, cv::Mat& dst, const CcmModel& model, double alpha) {
+    CCM_TRACE_SCOPE("applyColorCorrection");
+    applyCcmModel(src, dst, model);
+    CCM_TRACE_SCOPE("convertTo");
+    dst.convertTo(dst, -1, alpha, 0);
+}
+
+void gammaCorrection(const cv::Mat& src, cv::Mat& dst, float gamma) {
+    CCM_TRACE_SCOPE("gammaCorrection");
+    // The table only changes with gamma, so keep the last one per thread.
+    thread_local float cachedGamma = std::nanf("");
+    thread_local cv::Mat lookUpTable(1, 256, CV_8U);
+    if (gamma != cachedGamma) {
+        uchar* p = lookUpTable.ptr();
+        for(int i = 0; i < 256; ++i)
+            p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
+        cachedGamma = gamma;
+    }
+    cv::LUT(src, lookUpTable, dst);
+}
+
+cv::Mat gammaCorrection(const cv::Mat& input, float gamma) {
+    cv::Mat output;
+    gammaCorrection(input, output, gamma);
+    return output;
+}
+
+void adjustWhiteBalance(const cv::Mat& src, cv::Mat& dst) {
+    CCM_TRACE_SCOPE("adjustWhiteBalance");
+    thread_local cv::Mat lab;
+    cv::cvtColor(src, lab, cv::COLOR_BGR2Lab);
+
+    // Shift a/b so their means land on the neutral point; no split/merge needed.
+    cv::subtract(lab, whiteBalanceShift(cv::mean(lab)), lab);
+
+    cv::cvtColor(lab, dst, cv::COLOR_Lab2BGR);
+}
+
+void adjustWhiteBalance(const cv::Mat& src, cv::Mat& dst, const cv::Scalar& labShift) {
+    CCM_TRACE_SCOPE("adjustWhiteBalance");
+    thread_local cv::Mat lab;
+    cv::cvtColor(src, lab, cv::COLOR_BGR2Lab);
+    cv::subtract(lab, labShift, lab);
+    cv::cvtColor(lab, dst, cv::COLOR_Lab2BGR);
+}
+
+cv::Scalar whiteBalanceShift(const cv::Scalar& labMean) {
+    return cv::Scalar(0, labMean[1] - 129, labMean[2] - 129);
+}
+
+cv::Mat adjustWhiteBalance(const cv::Mat &img) {
+    cv::Mat result;
+    adjustWhiteBalance(img, result);
+    return result;
+}
+
+void unsharpMask(const cv::Mat& src, cv::Mat& dst, float amount) {
+    CCM_TRACE_SCOPE("unsharpMask");
+    thread_local cv::Mat blurred;
+    cv::GaussianBlur(src, blurred, cv::Size(0, 0), 3);
+    cv::addWeighted(src, 1 + amount, blurred, -amount, 0, dst);
+}
+
+cv::Mat unsharpMask(const cv::Mat& input, float amount) {
+    cv::Mat sharpened;
+    unsharpMask(input, sharpened, amount);
+    return sharpened;
+}
+
+void bilateralFilter(const cv::Mat& src, cv::Mat& dst, int d, double sigmaColor, double sigmaSpace) {
+    CCM_TRACE_SCOPE("bilateralFilter");
+    if (src.data != dst.data) {
+        cv::bilateralFilter(src, dst, d, sigmaColor, sigmaSpace);
+        return;
+    }
+    // cv::bilateralFilter cannot run in place
+    thread_local cv::Mat filtered;
+    cv::bilateralFilter(src, filtered, d, sigmaColor, sigmaSpace);
+    filtered.copyTo(dst);
+}
+
+cv::Mat bilateralFilter(const cv::Mat& input, int d, double sigmaColor, double sigmaSpace) {
+    cv::Mat output;
+    bilateralFilter(input, output, d, sigmaColor, sigmaSpace);
+    return output;
+}
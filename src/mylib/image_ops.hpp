@@ -0,0 +1,35 @@
+#ifndef IMAGE_OPS_H
+#define IMAGE_OPS_H
+
+#include <opencv2/opencv.hpp>
+
+#include "ccm_model.hpp"
+
+// Post-correction operators used by the image and video tools.
+// Every operator has a (src, dst) form that writes into a caller-owned buffer
+// (reused when it already has the right size and type) and may be called
+// in place with dst == src. Scratch buffers are kept per thread, so a loop that
+// keeps its own dst allocates nothing after the first frame.
+// The returning forms are kept for convenience and allocate a new result.
+
+void applyColorCorrection(const cv::Mat& src, cv::Mat& dst, const cv::Mat& ColorMatrix, double alpha = 0.95);
+cv::Mat applyColorCorrection(const cv::Mat& img, const cv::Mat& ColorMatrix);
+void applyColorCorrection(const cv::Mat& src, cv::Mat& dst, const CcmModel& model, double alpha = 0.95);
+
+void gammaCorrection(const cv::Mat& src, cv::Mat& dst, float gamma);
+cv::Mat gammaCorrection(const cv::Mat& input, float gamma);
+
+void adjustWhiteBalance(const cv::Mat& src, cv::Mat& dst);
+// Same correction with a Lab shift measured elsewhere (e.g. over a whole image processed in strips):
+// labShift = (0, mean a - 129, mean b - 129).
+void adjustWhiteBalance(const cv::Mat& src, cv::Mat& dst, const cv::Scalar& labShift);
+cv::Scalar whiteBalanceShift(const cv::Scalar& labMean);
+cv::Mat adjustWhiteBalance(const cv::Mat &img);
+
+void unsharpMask(const cv::Mat& src, cv::Mat& dst, float amount);
+cv::Mat unsharpMask(const cv::Mat& input, float amount);
+
+void bilateralFilter(const cv::Mat& src, cv::Mat& dst, int d, double sigmaColor, double sigmaSpace);
+cv::Mat bilateralFilter(const cv::Mat& input, int d, double sigmaColor, double sigmaSpace);
+
+#endif // IMAGE_OPS_H
@@ -0,0 +1,463 @@
+#include "job_scheduler.hpp"
+#include "metrics.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Frames decoded per visit to a video: the decoding worker corrects the last one
+// itself and leaves the rest for thieves.
+const int kDecodeBatch = 4;
+
+enum SlotState { Free, Queued, Done };
+
+struct Slot {
+    cv::Mat src, dst;
+    std::atomic<int> state{Free};
+};
+
+struct Probe {
+    size_t index = 0;
+    int64_t frames = 0;   // CAP_PROP_FRAME_COUNT, 0 when the container does not say
+    cv::Size size;
+    double fps = 0;
+};
+
+// An open video. Frame n lives in slots[n % window] from decode until it is written,
+// so decoding stalls once the encoder is `window` frames behind.
+// cap is only touched under readMutex, writer only under writeMutex.
+struct ActiveJob {
+    Probe probe;
+    const BatchItem* item = nullptr;
+    cv::VideoCapture cap;
+    cv::VideoWriter writer;
+    std::unique_ptr<Slot[]> slots;
+    int window = 0;
+    size_t reservedBytes = 0;
+    std::mutex readMutex, writeMutex;
+    std::atomic<int64_t> decoded{0}, written{0};
+    std::atomic<bool> eof{false}, failed{false}, finished{false};
+    std::chrono::steady_clock::time_point start;
+
+    Slot& slot(int64_t frame) { return slots[frame % window]; }
+    int64_t framesLeft() const {
+        return probe.frames > 0 ? std::max<int64_t>(probe.frames - decoded, 0) : INT64_MAX / 2;
+    }
+};
+using JobPtr = std::shared_ptr<ActiveJob>;
+
+struct Task {
+    JobPtr job;
+    int64_t frame = 0;
+};
+
+// The owner pushes and pops at the back (newest frame, still in cache); thieves
+// take the oldest frame from the front, which is also the one the encoder needs first.
+class WorkDeque {
+public:
+    void push(Task task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    bool pop(Task& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        task = std::move(tasks_.back());
+        tasks_.pop_back();
+        return true;
+    }
+    bool steal(Task& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty())
+            return false;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<Task> tasks_;
+};
+
+class Scheduler {
+public:
+    Scheduler(const std::vector<BatchItem>& items, const FrameOp& op, const SchedulerOptions& options)
+        : items_(items), op_(op), options_(options), results_(items.size()) {
+        workers_ = options.threads > 0 ? options.threads
+                                       : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        maxActive_ = options.maxActiveJobs > 0 ? options.maxActiveJobs : workers_;
+        for (int w = 0; w < workers_; w++)
+            deques_.push_back(std::make_unique<WorkDeque>());
+    }
+
+    SchedulerSummary run();
+
+private:
+    void probeJobs();
+    void admitJobs();   // mutex_ held
+    void worker(int self);
+    bool steal(int self, Task& task);
+    bool decodeFrames(int self);
+    void correct(const Task& task);
+    void drainWriter(const JobPtr& job);
+    void maybeFinish(const JobPtr& job);
+    void fail(size_t index);   // mutex_ held
+    void reportProgress(std::chrono::steady_clock::time_point start);
+
+    const std::vector<BatchItem>& items_;
+    const FrameOp& op_;
+    SchedulerOptions options_;
+    int workers_ = 1, maxActive_ = 1;
+    std::vector<std::unique_ptr<WorkDeque>> deques_;
+
+    std::mutex mutex_;   // guards everything below except the atomics
+    std::condition_variable wake_;
+    std::vector<Probe> pending_;   // longest first
+    size_t nextPending_ = 0;
+    std::vector<JobPtr> active_;
+    size_t reservedBytes_ = 0;
+    std::vector<JobResult> results_;
+    std::atomic<size_t> remaining_{0}, framesDone_{0};
+    Counter& framesCounter_ = metrics().counter("ccm_frames_processed_total", "Frames corrected and handed to the encoder");
+};
+
+void Scheduler::probeJobs() {
+    CCM_TRACE_SCOPE("probeJobs");
+    for (size_t i = 0; i < items_.size(); i++) {
+        cv::VideoCapture cap(items_[i].input);
+        if (!cap.isOpened()) {
+            std::cerr << "Error: Could not open " << items_[i].input << std::endl;
+            continue;
+        }
+        Probe p;
+        p.index = i;
+        p.frames = std::max<int64_t>(0, static_cast<int64_t>(cap.get(cv::CAP_PROP_FRAME_COUNT)));
+        p.size = cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        p.fps = cap.get(cv::CAP_PROP_FPS);
+        pending_.push_back(p);
+    }
+    // Longest processing time first: the long videos start early and the short
+    // ones balance the tail.
+    std::stable_sort(pending_.begin(), pending_.end(), [](const Probe& a, const Probe& b) {
+        return double(a.frames) * a.size.area() > double(b.frames) * b.size.area();
+    });
+    remaining_ = pending_.size();
+}
+
+void Scheduler::fail(size_t index) {
+    results_[index].ok = false;
+    remaining_--;
+}
+
+void Scheduler::admitJobs() {
+    while (nextPending_ < pending_.size() && static_cast<int>(active_.size()) < maxActive_) {
+        const Probe& p = pending_[nextPending_];
+        const size_t slotBytes = size_t(p.size.area()) * 3 * 2;
+        const size_t available = options_.memoryBudget > reservedBytes_ ? options_.memoryBudget - reservedBytes_ : 0;
+        // More than two slots per worker cannot keep anyone busier.
+        int window = static_cast<int>(std::min<size_t>(available / std::max<size_t>(slotBytes, 1), 2 * workers_));
+        if (window < 2) {
+            if (!active_.empty())
+                return;   // wait for a running video to release its slots
+            window = 2;   // a single video over budget still has to run
+        }
+        nextPending_++;
+
+        auto job = std::make_shared<ActiveJob>();
+        job->probe = p;
+        job->item = &items_[p.index];
+        job->cap.open(job->item->input);
+        job->writer.open(job->item->output, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), p.fps > 0 ? p.fps : 25.0, p.size);
+        if (!job->cap.isOpened() || !job->writer.isOpened()) {
+            std::cerr << "Error: Could not open " << job->item->input << " -> " << job->item->output << std::endl;
+            fail(p.index);
+            continue;
+        }
+        job->window = window;
+        job->slots.reset(new Slot[window]);
+        job->reservedBytes = size_t(window) * slotBytes;
+        job->start = std::chrono::steady_clock::now();
+        reservedBytes_ += job->reservedBytes;
+        active_.push_back(job);
+    }
+}
+
+bool Scheduler::steal(int self, Task& task) {
+    for (int k = 1; k < workers_; k++)
+        if (deques_[(self + k) % workers_]->steal(task))
+            return true;
+    return false;
+}
+
+// Decode up to kDecodeBatch frames of the open video with the most frames left
+// whose decoder is free and which has free slots.
+bool Scheduler::decodeFrames(int self) {
+    // framesLeft() moves under other workers, so sort a snapshot of it.
+    std::vector<std::pair<int64_t, JobPtr>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const JobPtr& job : active_)
+            candidates.emplace_back(job->framesLeft(), job);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& candidate : candidates) {
+        const JobPtr& job = candidate.second;
+        if (job->eof)
+            continue;
+        std::unique_lock<std::mutex> read(job->readMutex, std::try_to_lock);
+        if (!read.owns_lock())
+            continue;
+        int decodedNow = 0;
+        while (decodedNow < kDecodeBatch && !job->eof) {
+            const int64_t n = job->decoded;
+            Slot& slot = job->slot(n);
+            if (slot.state != Free)
+                break;
+            bool ok;
+            {
+                CCM_TRACE_SCOPE("cap.read");
+                ok = job->cap.read(slot.src) && !slot.src.empty();
+            }
+            if (!ok) {
+                job->eof = true;
+                job->cap.release();
+                break;
+            }
+            slot.state = Queued;
+            job->decoded = n + 1;
+            deques_[self]->push(Task{job, n});
+            decodedNow++;
+        }
+        const bool eof = job->eof;
+        read.unlock();
+        if (decodedNow > 1)
+            wake_.notify_all();
+        if (eof)
+            maybeFinish(job);
+        if (decodedNow > 0 || eof)
+            return true;
+    }
+    return false;
+}
+
+void Scheduler::correct(const Task& task) {
+    CCM_TRACE_FRAME("frame", task.frame);
+    Slot& slot = task.job->slot(task.frame);
+    try {
+        CCM_TRACE_SCOPE("correct");
+        op_(slot.src, slot.dst);
+    } catch (const std::exception& e) {
+        if (!task.job->failed.exchange(true))
+            std::cerr << "Error processing " << task.job->item->input << ": " << e.what() << std::endl;
+        slot.src.copyTo(slot.dst);   // keep the output in step with the input
+    }
+    slot.state = Done;
+    drainWriter(task.job);
+}
+
+// Writes every completed frame in order. Whoever holds writeMutex writes; after
+// releasing it the next slot is checked again, so a frame completed meanwhile by a
+// worker that found the mutex taken is never left behind.
+void Scheduler::drainWriter(const JobPtr& job) {
+    for (;;) {
+        std::unique_lock<std::mutex> write(job->writeMutex, std::try_to_lock);
+        if (!write.owns_lock())
+            return;
+        size_t count = 0;
+        for (int64_t n = job->written; job->slot(n).state == Done; n = job->written) {
+            {
+                CCM_TRACE_SCOPE("VideoWriter::write");
+                job->writer.write(job->slot(n).dst);
+            }
+            job->slot(n).state = Free;
+            job->written = n + 1;
+            count++;
+        }
+        write.unlock();
+        if (count) {
+            framesDone_ += count;
+            framesCounter_.add(count);
+            wake_.notify_all();   // slots are free for the decoder again
+        }
+        if (job->slot(job->written).state != Done)
+            break;
+    }
+    maybeFinish(job);
+}
+
+void Scheduler::maybeFinish(const JobPtr& job) {
+    if (!job->eof || job->written != job->decoded || job->finished.exchange(true))
+        return;
+    {
+        std::lock_guard<std::mutex> write(job->writeMutex);
+        job->writer.release();
+    }
+    countFileBytes(job->item->input, job->item->output);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    JobResult& result = results_[job->probe.index];
+    result.frames = static_cast<size_t>(job->written);
+    result.ok = !job->failed && result.frames > 0;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job->start).count();
+    std::cout << (result.ok ? "Processed video saved at: " : "Failed: ") << job->item->output << std::endl;
+
+    reservedBytes_ -= job->reservedBytes;
+    active_.erase(std::remove(active_.begin(), active_.end(), job), active_.end());
+    remaining_--;
+    admitJobs();
+    wake_.notify_all();
+}
+
+void Scheduler::worker(int self) {
+    CCM_TRACE_THREAD("video worker");
+    Task task;
+    while (remaining_ > 0) {
+        if (deques_[self]->pop(task) || steal(self, task)) {
+            correct(task);
+            task.job.reset();
+            continue;
+        }
+        if (decodeFrames(self))
+            continue;
+        // Nothing to do until a slot frees up or another worker queues frames.
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(2));
+    }
+}
+
+void Scheduler::reportProgress(std::chrono::steady_clock::time_point start) {
+    std::vector<JobPtr> active;
+    size_t pendingFrames = 0, done = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active = active_;
+        for (size_t i = nextPending_; i < pending_.size(); i++)
+            pendingFrames += pending_[i].frames;
+        done = items_.size() - remaining_;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - start).count();
+    const double fps = elapsed > 0 ? framesDone_ / elapsed : 0;
+
+    size_t leftFrames = pendingFrames;
+    for (const JobPtr& job : active) {
+        const int64_t written = job->written, total = job->probe.frames;
+        const double jobElapsed = std::chrono::duration<double>(now - job->start).count();
+        const double jobFps = jobElapsed > 0 ? written / jobElapsed : 0;
+        std::cout << "  " << fs::path(job->item->input).filename().string() << ": " << written;
+        if (total > 0) {
+            leftFrames += static_cast<size_t>(std::max<int64_t>(total - written, 0));
+            std::cout << "/" << total << " frames (" << 100 * written / total << "%), " << jobFps << " fps";
+            if (jobFps > 0)
+                std::cout << ", ETA " << static_cast<int>((total - written) / jobFps) << " s";
+        } else {
+            std::cout << " frames, " << jobFps << " fps";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Videos: " << done << "/" << items_.size() << " done, " << framesDone_ << " frames, " << fps << " fps";
+    if (fps > 0)
+        std::cout << ", ETA " << static_cast<int>(leftFrames / fps) << " s";
+    std::cout << std::endl;
+}
+
+SchedulerSummary Scheduler::run() {
+    CCM_TRACE_SCOPE("runVideoJobs");
+    const auto start = std::chrono::steady_clock::now();
+    probeJobs();
+    for (size_t i = 0; i < items_.size(); i++)
+        results_[i].input = items_[i].input;
+
+    // The pool is the whole thread budget: no nested parallel_for_ inside the op.
+    const ParallelConfig saved = getParallelConfig();
+    ParallelConfig serial = saved;
+    serial.threads = 1;
+    setParallelConfig(serial);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        admitJobs();
+    }
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers_; w++)
+        pool.emplace_back([this, w] { worker(w); });
+
+    // The calling thread only reports progress.
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto interval = std::chrono::duration<double>(options_.progressInterval > 0 ? options_.progressInterval : 3600.0);
+        while (!wake_.wait_for(lock, interval, [this] { return remaining_ == 0; })) {
+            if (options_.progressInterval > 0) {
+                lock.unlock();
+                reportProgress(start);
+                lock.lock();
+            }
+        }
+    }
+    for (std::thread& t : pool)
+        t.join();
+    setParallelConfig(saved);
+
+    SchedulerSummary summary;
+    summary.jobs = results_;
+    for (const JobResult& r : summary.jobs) {
+        summary.frames += r.frames;
+        summary.failed += r.ok ? 0 : 1;
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+} // namespace
+
+bool readVideoManifest(const std::string& path, const std::string& outputDir, std::vector<BatchItem>& jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open manifest " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#')
+            continue;
+        BatchItem item;
+        size_t comma = line.find(',');
+        item.input = line.substr(0, comma);
+        item.output = comma == std::string::npos ? outputDir + "/" + fs::path(item.input).filename().string()
+                                                 : line.substr(comma + 1);
+        jobs.push_back(item);
+    }
+    return true;
+}
+
+SchedulerSummary runVideoJobs(const std::vector<BatchItem>& jobs, const FrameOp& op, const SchedulerOptions& options) {
+    Scheduler scheduler(jobs, op, options);
+    return scheduler.run();
+}
+
+void printSchedulerSummary(std::ostream& os, const SchedulerSummary& summary) {
+    for (const JobResult& r : summary.jobs)
+        os << "  " << r.input << ": " << (r.ok ? "ok" : "FAILED") << ", " << r.frames << " frames in " << r.seconds << " s" << std::endl;
+    os << "Videos: " << summary.jobs.size() - summary.failed << " ok, " << summary.failed << " failed, "
+       << summary.frames << " frames in " << summary.seconds << " s (" << summary.framesPerSecond() << " fps)" << std::endl;
+}
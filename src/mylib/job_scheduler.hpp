@@ -0,0 +1,58 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <opencv2/opencv.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "batch_processor.hpp"
+#include "frame_pipeline.hpp"
+
+struct SchedulerOptions {
+    int threads = 0;                          // worker threads, 0 = one per core
+    size_t memoryBudget = size_t(1) << 30;    // bytes of frame slots (source + corrected) over all videos
+    int maxActiveJobs = 0;                    // videos open at once, 0 = one per worker
+    double progressInterval = 2.0;            // seconds between progress reports, <= 0 = none
+};
+
+struct JobResult {
+    std::string input;
+    bool ok = false;
+    size_t frames = 0;
+    double seconds = 0;
+};
+
+struct SchedulerSummary {
+    std::vector<JobResult> jobs;   // in input order
+    size_t frames = 0, failed = 0;
+    double seconds = 0;
+
+    double framesPerSecond() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// A directory of videos is collectImages(dir, outputDir, {".mp4"}).
+// One video per line, "input" or "input,output"; blank lines and '#' comments are
+// skipped. Without an output the video goes to outputDir/<filename>.
+bool readVideoManifest(const std::string& path, const std::string& outputDir, std::vector<BatchItem>& jobs);
+
+// Runs every job through `op` on one pool of `threads` workers, with frame-level
+// tasks: decoding a frame queues its correction on the decoding worker's deque,
+// idle workers steal from the others, and each video is encoded in frame order by
+// whichever worker completes the next frame. Decoding and encoding stay sequential
+// per video; correction of different frames runs concurrently, so `op` must be
+// reentrant: no per-video state, safe on several threads at once.
+//
+// Jobs are probed first and opened longest-first (frames x pixels), and idle
+// workers decode for the open video with the most frames left, so a long video
+// keeps the cores while short ones fill in around it. Each open video gets a
+// window of frame slots sized from what is left of memoryBudget; a video is only
+// opened when at least two slots fit (or nothing else is running). OpenCV's own
+// parallel_for_ is limited to one thread for the duration, so the pool is the
+// whole thread budget.
+SchedulerSummary runVideoJobs(const std::vector<BatchItem>& jobs, const FrameOp& op,
+                              const SchedulerOptions& options = SchedulerOptions());
+
+void printSchedulerSummary(std::ostream& os, const SchedulerSummary& summary);
+
+#endif // JOB_SCHEDULER_H
@@ -0,0 +1,184 @@
+#include "lut3d.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+
+Lut3D bakeLut3D(const PixelTransform& fn, int size) {
+    Lut3D lut;
+    if (size < 2 || size > 256) {
+        std::cerr << "Error: LUT size must be in [2, 256], got " << size << std::endl;
+        return lut;
+    }
+
+    lut.size = size;
+    lut.table.resize(static_cast<size_t>(size) * size * size);
+    const float step = 255.0f / (size - 1);
+
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                cv::Vec3f v = fn(cv::Vec3f(b * step, g * step, r * step));
+                for (int c = 0; c < 3; c++)
+                    v[c] = std::clamp(v[c], 0.0f, 255.0f);
+                lut.table[(b * size + g) * size + r] = v;
+            }
+        }
+    }
+    refreshLut3D(lut);
+    return lut;
+}
+
+void refreshLut3D(Lut3D& lut) {
+    lut.fixed.resize(lut.table.size());
+    for (size_t i = 0; i < lut.table.size(); i++) {
+        const cv::Vec3f& v = lut.table[i];
+        lut.fixed[i] = cv::Vec3s(cv::saturate_cast<short>(v[0] * 16.0f),
+                                 cv::saturate_cast<short>(v[1] * 16.0f),
+                                 cv::saturate_cast<short>(v[2] * 16.0f));
+    }
+}
+
+void applyLut3D(const cv::Mat& src, cv::Mat& dst, const Lut3D& lut) {
+    CCM_TRACE_SCOPE("applyLut3D");
+    CV_Assert(src.type() == CV_8UC3);
+    CV_Assert(!lut.empty() && lut.fixed.size() == lut.table.size());
+
+    const int n = lut.size;
+
+    // Per 8-bit code: lower grid index and Q8 weight towards the next node.
+    // The last cell is closed so code 255 lands exactly on node n-1.
+    int index[256], weight[256];
+    for (int v = 0; v < 256; v++) {
+        double pos = v * (n - 1) / 255.0;
+        int i0 = std::min(static_cast<int>(pos), n - 2);
+        index[v] = i0;
+        weight[v] = static_cast<int>(std::lround((pos - i0) * 256.0));
+    }
+
+    dst.create(src.size(), src.type());
+    const cv::Vec3s* table = lut.fixed.data();
+    const int strideG = n, strideB = n * n;
+
+    parallelRows(src.rows, [&](int rowStart, int rowEnd) {
+        for (int y = rowStart; y < rowEnd; y++) {
+            const uchar* SP = src.ptr<uchar>(y);
+            uchar* DP = dst.ptr<uchar>(y);
+            for (int x = 0; x < src.cols * 3; x += 3) {
+                int bi = SP[x], gi = SP[x + 1], ri = SP[x + 2];
+                const cv::Vec3s* c0 = table + index[bi] * strideB + index[gi] * strideG + index[ri];
+
+                // Tetrahedral interpolation: walk the cube diagonal in order of
+                // decreasing weight, so only 4 of the 8 corners are touched.
+                int w1 = weight[ri], w2 = weight[gi], w3 = weight[bi];
+                int s1 = 1, s2 = strideG, s3 = strideB;
+                if (w1 < w2) { std::swap(w1, w2); std::swap(s1, s2); }
+                if (w2 < w3) { std::swap(w2, w3); std::swap(s2, s3); }
+                if (w1 < w2) { std::swap(w1, w2); std::swap(s1, s2); }
+
+                const cv::Vec3s& p0 = c0[0];
+                const cv::Vec3s& p1 = c0[s1];
+                const cv::Vec3s& p2 = c0[s1 + s2];
+                const cv::Vec3s& p3 = c0[s1 + s2 + s3];
+                int k0 = 256 - w1, k1 = w1 - w2, k2 = w2 - w3, k3 = w3;
+
+                for (int c = 0; c < 3; c++) {
+                    int acc = p0[c] * k0 + p1[c] * k1 + p2[c] * k2 + p3[c] * k3;  // Q4 * Q8
+                    DP[x + c] = cv::saturate_cast<uchar>((acc + 2048) >> 12);
+                }
+            }
+        }
+    });
+}
+
+cv::Mat applyLut3D(const cv::Mat& src, const Lut3D& lut) {
+    cv::Mat dst;
+    applyLut3D(src, dst, lut);
+    return dst;
+}
+
+bool readCubeFile(const std::string& path, Lut3D& lut) {
+    std::ifstream infile(path);
+    if (!infile) {
+        std::cerr << "Error opening the cube file: " << path << std::endl;
+        return false;
+    }
+
+    Lut3D result;
+    size_t count = 0;
+    std::string textline;
+    while (getline(infile, textline)) {
+        std::istringstream line(textline);
+        std::string key;
+        if (!(line >> key) || key[0] == '#')
+            continue;
+
+        if (key == "TITLE") {
+            continue;
+        } else if (key == "LUT_3D_SIZE") {
+            line >> result.size;
+            if (result.size < 2 || result.size > 256) {
+                std::cerr << "Error: unsupported LUT_3D_SIZE in " << path << std::endl;
+                return false;
+            }
+            result.table.resize(static_cast<size_t>(result.size) * result.size * result.size);
+        } else if (key == "LUT_1D_SIZE") {
+            std::cerr << "Error: 1D cube files are not supported: " << path << std::endl;
+            return false;
+        } else if (key == "DOMAIN_MIN" || key == "DOMAIN_MAX") {
+            float a, b, c;
+            line >> a >> b >> c;
+            float expected = key == "DOMAIN_MIN" ? 0.0f : 1.0f;
+            if (a != expected || b != expected || c != expected) {
+                std::cerr << "Error: only the default 0..1 domain is supported: " << path << std::endl;
+                return false;
+            }
+        } else if (std::isalpha(static_cast<unsigned char>(key[0]))) {
+            continue;  // other vendor keywords (LUT_3D_INPUT_RANGE, ...)
+        } else {
+            if (result.size == 0 || count >= result.table.size()) {
+                std::cerr << "Error: unexpected data line in " << path << std::endl;
+                return false;
+            }
+            std::istringstream first(key);
+            float r, g, b;
+            if (!(first >> r) || first.peek() != EOF || !(line >> g >> b)) {
+                std::cerr << "Error: malformed data line in " << path << std::endl;
+                return false;
+            }
+            result.table[count++] = cv::Vec3f(std::clamp(b, 0.0f, 1.0f) * 255.0f,
+                                              std::clamp(g, 0.0f, 1.0f) * 255.0f,
+                                              std::clamp(r, 0.0f, 1.0f) * 255.0f);
+        }
+    }
+
+    if (result.size == 0 || count != result.table.size()) {
+        std::cerr << "Error: incomplete cube file: " << path << std::endl;
+        return false;
+    }
+    refreshLut3D(result);
+    lut = std::move(result);
+    return true;
+}
+
+bool writeCubeFile(const std::string& path, const Lut3D& lut, const std::string& title) {
+    std::ofstream outfile(path);
+    if (!outfile) {
+        std::cerr << "Error opening the cube file for writing: " << path << std::endl;
+        return false;
+    }
+
+    if (!title.empty())
+        outfile << "TITLE \"" << title << "\"\n";
+    outfile << "LUT_3D_SIZE " << lut.size << "\n";
+    outfile << std::fixed << std::setprecision(6);
+    for (const cv::Vec3f& v : lut.table)
+        outfile << v[2] / 255.0f << " " << v[1] / 255.0f << " " << v[0] / 255.0f << "\n";
+
+    return static_cast<bool>(outfile);
+}
@@ -0,0 +1,35 @@
+#ifndef LUT3D_H
+#define LUT3D_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 3D colour lookup table: a BGR -> BGR pixel function sampled on a size^3 grid over [0,255].
+// Entries use .cube ordering (R fastest, then G, then B).
+struct Lut3D {
+    int size = 0;
+    std::vector<cv::Vec3f> table;      // BGR values in [0,255]
+    std::vector<cv::Vec3s> fixed;      // same table in Q4, used by applyLut3D
+
+    bool empty() const { return size == 0; }
+    const cv::Vec3f& at(int b, int g, int r) const { return table[(b * size + g) * size + r]; }
+};
+
+using PixelTransform = std::function<cv::Vec3f(const cv::Vec3f& bgr)>;
+
+// Sample a pointwise chain (HSL, CCM, brightness, gamma...) into a LUT.
+Lut3D bakeLut3D(const PixelTransform& fn, int size = 33);
+// Rebuild the fixed-point table after editing lut.table directly.
+void refreshLut3D(Lut3D& lut);
+
+// Apply the LUT to a CV_8UC3 image with tetrahedral interpolation in a single pass.
+void applyLut3D(const cv::Mat& src, cv::Mat& dst, const Lut3D& lut);
+cv::Mat applyLut3D(const cv::Mat& src, const Lut3D& lut);
+
+// .cube (Adobe/Resolve) import and export so graded looks can be shared.
+bool readCubeFile(const std::string& path, Lut3D& lut);
+bool writeCubeFile(const std::string& path, const Lut3D& lut, const std::string& title = "");
+
+#endif // LUT3D_H
@@ -0,0 +1,239 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+int bucketIndex(uint64_t v) {
+    if (v < LatencyHistogram::kSubBuckets)
+        return static_cast<int>(v);
+    int exponent = 63 - __builtin_clzll(v);   // >= 4
+    int sub = static_cast<int>((v >> (exponent - 4)) & (LatencyHistogram::kSubBuckets - 1));
+    return (exponent - 3) * LatencyHistogram::kSubBuckets + sub;
+}
+
+double bucketMidpoint(int index) {
+    if (index < LatencyHistogram::kSubBuckets)
+        return index;
+    int exponent = index / LatencyHistogram::kSubBuckets + 3;
+    int sub = index % LatencyHistogram::kSubBuckets;
+    double width = std::ldexp(1.0, exponent - 4);
+    return (LatencyHistogram::kSubBuckets + sub) * width + width / 2;
+}
+
+// `stage="decode",queue="x"` -> `stage=decode,queue=x` for line protocol tags.
+std::string lineProtocolTags(const std::string& labels) {
+    std::string tags;
+    for (char c : labels) {
+        if (c == '"')
+            continue;
+        if (c == ' ')
+            tags += "\\ ";
+        else
+            tags += c;
+    }
+    return tags;
+}
+
+std::string withLabels(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    std::string all = labels;
+    if (!extra.empty())
+        all += (all.empty() ? "" : ",") + extra;
+    return all.empty() ? name : name + "{" + all + "}";
+}
+
+} // namespace
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(micros, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (micros > seen && !max_.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::percentile(double p) const {
+    // Counts are read without a snapshot; concurrent records can shift the result by a bucket.
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_)
+        total += bucket.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * total));
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucketMidpoint(i), static_cast<double>(max()));
+    }
+    return static_cast<double>(max());
+}
+
+MetricsRegistry::Entry& MetricsRegistry::find(Kind kind, const std::string& name, const std::string& help,
+                                              const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : entries_) {
+        if (entry.name == name && entry.labels == labels) {
+            if (entry.kind != kind)
+                throw std::logic_error("metric " + name + " registered with another type");
+            return entry;
+        }
+    }
+    entries_.push_back(Entry{kind, name, help, labels, nullptr, nullptr, nullptr});
+    Entry& entry = entries_.back();
+    if (kind == CounterKind)
+        entry.counter = std::make_unique<Counter>();
+    else if (kind == GaugeKind)
+        entry.gauge = std::make_unique<Gauge>();
+    else
+        entry.histogram = std::make_unique<LatencyHistogram>();
+    return entry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    return *find(CounterKind, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    return *find(GaugeKind, name, help, labels).gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const std::string& labels) {
+    return *find(HistogramKind, name, help, labels).histogram;
+}
+
+void MetricsRegistry::writePrometheus(std::ostream& os) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<bool> written(entries_.size(), false);
+    for (size_t first = 0; first < entries_.size(); first++) {
+        if (written[first])
+            continue;
+        // HELP/TYPE once per family, then every labelled series of that family.
+        const Entry& family = entries_[first];
+        const char* type = family.kind == CounterKind ? "counter" : family.kind == GaugeKind ? "gauge" : "summary";
+        os << "# HELP " << family.name << " " << family.help << "\n";
+        os << "# TYPE " << family.name << " " << type << "\n";
+        for (size_t i = first; i < entries_.size(); i++) {
+            const Entry& entry = entries_[i];
+            if (written[i] || entry.name != family.name)
+                continue;
+            written[i] = true;
+            if (entry.kind == CounterKind) {
+                os << withLabels(entry.name, entry.labels) << " " << entry.counter->value() << "\n";
+            } else if (entry.kind == GaugeKind) {
+                os << withLabels(entry.name, entry.labels) << " " << entry.gauge->value() << "\n";
+            } else {
+                const LatencyHistogram& h = *entry.histogram;
+                for (const char* q : {"0.5", "0.95", "0.99"})
+                    os << withLabels(entry.name, entry.labels, std::string("quantile=\"") + q + "\"") << " "
+                       << h.percentile(std::atof(q)) / 1e6 << "\n";
+                os << withLabels(entry.name + "_sum", entry.labels) << " " << h.sum() / 1e6 << "\n";
+                os << withLabels(entry.name + "_count", entry.labels) << " " << h.count() << "\n";
+            }
+        }
+    }
+}
+
+void MetricsRegistry::writeLineProtocol(std::ostream& os) const {
+    const long long timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Entry& entry : entries_) {
+        os << entry.name;
+        if (!entry.labels.empty())
+            os << "," << lineProtocolTags(entry.labels);
+        if (entry.kind == CounterKind) {
+            os << " value=" << entry.counter->value() << "u";
+        } else if (entry.kind == GaugeKind) {
+            os << " value=" << entry.gauge->value() << "i";
+        } else {
+            const LatencyHistogram& h = *entry.histogram;
+            os << " p50_us=" << h.percentile(0.5) << ",p95_us=" << h.percentile(0.95)
+               << ",p99_us=" << h.percentile(0.99) << ",max_us=" << h.max() << "u,count=" << h.count() << "u";
+        }
+        os << " " << timestamp << "\n";
+    }
+}
+
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void countFileBytes(const std::string& readPath, const std::string& writtenPath) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(readPath, ec);
+    if (!ec)
+        metrics().counter("ccm_bytes_read_total", "Bytes read from input files").add(size);
+    size = std::filesystem::file_size(writtenPath, ec);
+    if (!ec)
+        metrics().counter("ccm_bytes_written_total", "Bytes written to output files").add(size);
+}
+
+MetricsFlusher::MetricsFlusher(const std::string& target, std::chrono::milliseconds interval)
+    : target_(target), interval_(interval) {
+    thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, interval_, [this] { return stop_; })) {
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    });
+}
+
+MetricsFlusher::~MetricsFlusher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    flush();
+}
+
+bool MetricsFlusher::flush() {
+    if (target_ == "-") {
+        metrics().writeLineProtocol(std::cout);
+        std::cout.flush();
+        return true;
+    }
+
+    const std::string tmp = target_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Error opening the metrics file: " << tmp << std::endl;
+            return false;
+        }
+        metrics().writePrometheus(out);
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, target_, ec);
+    if (ec) {
+        std::cerr << "Error replacing the metrics file " << target_ << ": " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<MetricsFlusher> MetricsFlusher::fromEnvironment() {
+    const char* target = std::getenv("CCM_METRICS_FILE");
+    if (!target || !*target)
+        return nullptr;
+    const char* interval = std::getenv("CCM_METRICS_INTERVAL_MS");
+    long ms = interval ? std::atol(interval) : 10000;
+    return std::make_unique<MetricsFlusher>(target, std::chrono::milliseconds(ms > 0 ? ms : 10000));
+}
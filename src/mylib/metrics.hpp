@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Always-on aggregate metrics: counters, gauges and latency histograms.
+// Updates are single relaxed atomic operations, so they can sit in per-frame loops.
+// Metrics are registered once by name (+ optional Prometheus labels, e.g.
+// `stage="decode"`); the returned references stay valid for the whole process.
+
+class Counter {
+public:
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Lock-free log-linear (HDR-style) histogram of microsecond latencies.
+// Every power of two is split into 16 linear sub-buckets, so any percentile is
+// within ~6% of the true value over the whole uint64 range, in a fixed 8 KB.
+class LatencyHistogram {
+public:
+    void record(uint64_t micros);
+    void record(std::chrono::steady_clock::duration d) {
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    // p in [0, 1]; returns microseconds (bucket midpoint), 0 when empty.
+    double percentile(double p) const;
+
+    static constexpr int kSubBuckets = 16;
+    static constexpr int kBuckets = (64 - 3) * kSubBuckets;
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0}, sum_{0}, max_{0};
+};
+
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    // Exported in seconds, as a Prometheus summary with p50/p95/p99.
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // Prometheus text exposition format.
+    void writePrometheus(std::ostream& os) const;
+    // InfluxDB line protocol, one line per metric.
+    void writeLineProtocol(std::ostream& os) const;
+
+private:
+    enum Kind { CounterKind, GaugeKind, HistogramKind };
+    struct Entry {
+        Kind kind;
+        std::string name, help, labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+    Entry& find(Kind kind, const std::string& name, const std::string& help, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::deque<Entry> entries_;
+};
+
+// Process-wide registry used by the pipeline, the batch runner and the tools.
+MetricsRegistry& metrics();
+
+// Adds the sizes of files a tool read and wrote to ccm_bytes_read_total /
+// ccm_bytes_written_total (for whole-file tools such as the video encoders).
+void countFileBytes(const std::string& readPath, const std::string& writtenPath);
+
+// Background thread that periodically writes the registry.
+// A file path gets the Prometheus text format, replaced atomically
+// (write to <path>.tmp, then rename) so scrapers never see a partial file;
+// "-" prints line protocol to stdout. A final flush happens on destruction.
+class MetricsFlusher {
+public:
+    MetricsFlusher(const std::string& target, std::chrono::milliseconds interval = std::chrono::seconds(10));
+    ~MetricsFlusher();
+    MetricsFlusher(const MetricsFlusher&) = delete;
+    MetricsFlusher& operator=(const MetricsFlusher&) = delete;
+
+    bool flush();
+
+    // From CCM_METRICS_FILE (and CCM_METRICS_INTERVAL_MS); nullptr when unset.
+    static std::unique_ptr<MetricsFlusher> fromEnvironment();
+
+private:
+    std::string target_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+#endif // METRICS_H
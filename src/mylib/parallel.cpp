@@ -0,0 +1,67 @@
+#include "parallel.hpp"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+namespace {
+
+int envInt(const char* name, int fallback) {
+    const char* value = std::getenv(name);
+    return value ? std::atoi(value) : fallback;
+}
+
+std::atomic<int>& grainRows() {
+    static std::atomic<int> grain(std::max(1, envInt("CCM_GRAIN_ROWS", 16)));
+    return grain;
+}
+
+std::atomic<int>& threadCount() {
+    static std::atomic<int> threads([] {
+        int n = envInt("CCM_THREADS", 0);
+        if (n > 0)
+            cv::setNumThreads(n);
+        return n;
+    }());
+    return threads;
+}
+
+} // namespace
+
+ParallelConfig getParallelConfig() {
+    ParallelConfig config;
+    config.threads = threadCount().load();
+    config.grainRows = grainRows().load();
+    return config;
+}
+
+void setParallelConfig(const ParallelConfig& config) {
+    threadCount().store(config.threads);
+    grainRows().store(std::max(1, config.grainRows));
+    cv::setNumThreads(config.threads > 0 ? config.threads : -1);
+}
+
+int rowBandCount(int rows) {
+    int grain = grainRows().load();
+    return (rows + grain - 1) / grain;
+}
+
+void parallelRowBands(int rows, const std::function<void(int, int, int)>& fn) {
+    threadCount();  // apply CCM_THREADS on first use
+    const int grain = grainRows().load();
+    const int bands = (rows + grain - 1) / grain;
+    if (bands <= 1) {
+        if (rows > 0)
+            fn(0, 0, rows);
+        return;
+    }
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        for (int band = range.start; band < range.end; band++)
+            fn(band, band * grain, std::min(rows, (band + 1) * grain));
+    }, bands);
+}
+
+void parallelRows(int rows, const std::function<void(int, int)>& fn) {
+    parallelRowBands(rows, [&](int, int rowStart, int rowEnd) { fn(rowStart, rowEnd); });
+}
@@ -0,0 +1,28 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+// Row-band execution on the shared OpenCV thread pool.
+// Bands are fixed-size blocks of grainRows rows, so the partition (and therefore
+// every per-band partial result) depends only on the image height and the grain,
+// never on the number of threads: output is identical for any thread count.
+struct ParallelConfig {
+    int threads = 0;      // 0 = OpenCV default (all cores)
+    int grainRows = 16;   // rows per task
+};
+
+// Defaults come from CCM_THREADS / CCM_GRAIN_ROWS when set.
+ParallelConfig getParallelConfig();
+void setParallelConfig(const ParallelConfig& config);
+
+// Number of bands parallelRows() splits `rows` into.
+int rowBandCount(int rows);
+
+// fn(rowStart, rowEnd) for every band.
+void parallelRows(int rows, const std::function<void(int, int)>& fn);
+// fn(band, rowStart, rowEnd); use the band index to store per-band partials and
+// merge them in band order for deterministic reductions.
+void parallelRowBands(int rows, const std::function<void(int, int, int)>& fn);
+
+#endif // PARALLEL_H
@@ -0,0 +1,126 @@
+#include "param_schedule.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+void ParamTrack::add(double frame, double value, Interpolation interpolation) {
+    Keyframe key{frame, value, interpolation};
+    auto pos = std::upper_bound(keys_.begin(), keys_.end(), frame,
+                                [](double f, const Keyframe& k) { return f < k.frame; });
+    keys_.insert(pos, key);
+}
+
+double ParamTrack::interpolate(double frame) const {
+    CV_Assert(!keys_.empty());
+    if (frame <= keys_.front().frame)
+        return keys_.front().value;
+    if (frame >= keys_.back().frame)
+        return keys_.back().value;
+    auto next = std::upper_bound(keys_.begin(), keys_.end(), frame,
+                                 [](double f, const Keyframe& k) { return f < k.frame; });
+    const Keyframe& a = *(next - 1);
+    const Keyframe& b = *next;
+    double t = (frame - a.frame) / (b.frame - a.frame);
+    switch (a.interpolation) {
+    case Interpolation::Step: t = 0; break;
+    case Interpolation::Smooth: t = t * t * (3 - 2 * t); break;
+    case Interpolation::Linear: break;
+    }
+    return a.value + t * (b.value - a.value);
+}
+
+bool ParamSchedule::empty() const {
+    return strength.empty() && hue.empty() && saturation.empty() && lightness.empty() && alpha.empty();
+}
+
+FrameParams ParamSchedule::at(double frame, const FrameParams& defaults) const {
+    FrameParams p;
+    p.strength = strength.at(frame, defaults.strength);
+    p.hue = hue.at(frame, defaults.hue);
+    p.saturation = saturation.at(frame, defaults.saturation);
+    p.lightness = lightness.at(frame, defaults.lightness);
+    p.alpha = alpha.at(frame, defaults.alpha);
+    return p;
+}
+
+bool readParamSchedule(const std::string& path, ParamSchedule& schedule) {
+    std::ifstream infile(path);
+    if (!infile) {
+        std::cerr << "Error opening the file: " << path << std::endl;
+        return false;
+    }
+    std::string textline;
+    int lineNumber = 0;
+    while (getline(infile, textline)) {
+        lineNumber++;
+        textline = textline.substr(0, textline.find('#'));
+        if (textline.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::vector<std::string> cells;
+        std::stringstream line(textline);
+        std::string cell;
+        while (getline(line, cell, ',')) {
+            cell.erase(0, cell.find_first_not_of(" \t"));
+            cell.erase(cell.find_last_not_of(" \t\r") + 1);
+            cells.push_back(cell);
+        }
+        if (cells.size() < 3 || cells.size() > 4) {
+            std::cerr << path << ":" << lineNumber << ": expected frame,parameter,value[,interpolation]" << std::endl;
+            return false;
+        }
+
+        double frame, value;
+        try {
+            frame = std::stod(cells[0]);
+            value = std::stod(cells[2]);
+        } catch (const std::exception&) {
+            std::cerr << path << ":" << lineNumber << ": invalid number" << std::endl;
+            return false;
+        }
+        Interpolation interpolation = Interpolation::Linear;
+        if (cells.size() == 4) {
+            if (cells[3] == "step")
+                interpolation = Interpolation::Step;
+            else if (cells[3] == "smooth")
+                interpolation = Interpolation::Smooth;
+            else if (cells[3] != "linear") {
+                std::cerr << path << ":" << lineNumber << ": unknown interpolation '" << cells[3] << "'" << std::endl;
+                return false;
+            }
+        }
+
+        ParamTrack* track = cells[1] == "strength"     ? &schedule.strength
+                            : cells[1] == "hue"        ? &schedule.hue
+                            : cells[1] == "saturation" ? &schedule.saturation
+                            : cells[1] == "lightness"  ? &schedule.lightness
+                            : cells[1] == "alpha"      ? &schedule.alpha
+                                                       : nullptr;
+        if (!track) {
+            std::cerr << path << ":" << lineNumber << ": unknown parameter '" << cells[1] << "'" << std::endl;
+            return false;
+        }
+        track->add(frame, value, interpolation);
+    }
+    return true;
+}
+
+cv::Matx33f composeFrameMatrix(const cv::Matx33f& ColorMatrix, double strength, double alpha) {
+    cv::Matx33f M;
+    for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+            M(k, c) = static_cast<float>(alpha * ((k == c ? 1.0 - strength : 0.0) + strength * ColorMatrix(k, c)));
+    return M;
+}
+
+bool isIdentityMatrix(const cv::Matx33f& M) {
+    // Below half a step of applyCCM()'s Q12 weights the fixed-point matrix is exactly I.
+    const float tolerance = 0.5f / 4096;
+    for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+            if (std::abs(M(k, c) - (k == c ? 1.0f : 0.0f)) >= tolerance)
+                return false;
+    return true;
+}
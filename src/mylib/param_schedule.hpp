@@ -0,0 +1,63 @@
+#ifndef PARAM_SCHEDULE_H
+#define PARAM_SCHEDULE_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// How a keyframe's value moves towards the next keyframe.
+enum class Interpolation { Step, Linear, Smooth };   // Smooth = smoothstep ease in/out
+
+struct Keyframe {
+    double frame = 0;
+    double value = 0;
+    Interpolation interpolation = Interpolation::Linear;
+};
+
+// One keyframed parameter. Before the first keyframe the value is the first
+// keyframe's, after the last it holds the last one's.
+class ParamTrack {
+public:
+    void add(double frame, double value, Interpolation interpolation = Interpolation::Linear);
+    bool empty() const { return keys_.empty(); }
+    // The value at `frame`, or `fallback` when the track has no keyframes.
+    double at(double frame, double fallback) const { return empty() ? fallback : interpolate(frame); }
+
+private:
+    double interpolate(double frame) const;   // requires !empty()
+
+    std::vector<Keyframe> keys_;   // sorted by frame
+};
+
+// Effective parameters of one frame. strength is the CCM blend e, hue/saturation/
+// lightness use the adjust_hsl convention, alpha is the brightness scale.
+struct FrameParams {
+    double strength = 1, hue = 0, saturation = 0, lightness = 0, alpha = 1;
+
+    bool hasHsl() const { return hue != 0 || saturation != 0 || lightness != 0; }
+};
+
+// Keyframed strength, hue, saturation, lightness and alpha. Parameters without
+// keyframes keep the defaults passed to at().
+//
+// File format: one keyframe per line, "frame,parameter,value[,step|linear|smooth]";
+// blank lines and '#' comments are skipped. The interpolation applies from that
+// keyframe to the next one of the same parameter.
+struct ParamSchedule {
+    ParamTrack strength, hue, saturation, lightness, alpha;
+
+    bool empty() const;
+    FrameParams at(double frame, const FrameParams& defaults = FrameParams()) const;
+};
+
+bool readParamSchedule(const std::string& path, ParamSchedule& schedule);
+
+// alpha * ((1 - strength) * I + strength * M): blending the original with the CCM
+// result and scaling the brightness are both linear in the matrix, so the whole
+// per-frame effect is one 3x3 composed here once per frame.
+cv::Matx33f composeFrameMatrix(const cv::Matx33f& ColorMatrix, double strength, double alpha);
+// True when applying M cannot change an 8-bit pixel: every entry is within the
+// Q12 step of the fixed-point kernel from the identity.
+bool isIdentityMatrix(const cv::Matx33f& M);
+
+#endif // PARAM_SCHEDULE_H
@@ -0,0 +1,190 @@
+#include "presets.hpp"
+#include "trace.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump whenever buildPipelineLut() or the stages it samples change what a preset bakes to.
+constexpr uint32_t kPresetCodeVersion = 1;
+
+constexpr char kLutMagic[4] = {'C', 'C', 'M', 'L'};
+constexpr uint32_t kLutFormatVersion = 1;
+
+struct LutFileHeader {
+    char magic[4];
+    uint32_t formatVersion;
+    uint64_t key;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+double number(const cv::FileNode& node, double fallback) {
+    return node.empty() ? fallback : static_cast<double>(node);
+}
+
+template <typename T>
+uint64_t hashValue(const T& value, uint64_t hash) {
+    return fnv1a(&value, sizeof(value), hash);
+}
+
+} // namespace
+
+bool readPresets(const std::string& path, std::vector<ScenePreset>& presets) {
+    try {
+        cv::FileStorage file(path, cv::FileStorage::READ);
+        if (!file.isOpened()) {
+            std::cerr << "Error opening the file: " << path << std::endl;
+            return false;
+        }
+        cv::FileNode list = file["presets"];
+        if (!list.isSeq()) {
+            std::cerr << "No 'presets' list in " << path << std::endl;
+            return false;
+        }
+        for (cv::FileNodeIterator it = list.begin(); it != list.end(); ++it) {
+            const cv::FileNode node = *it;
+            ScenePreset preset;
+            preset.name = static_cast<std::string>(node["name"]);
+            if (preset.name.empty()) {
+                std::cerr << "Preset without a name in " << path << std::endl;
+                return false;
+            }
+            if (!node["description"].empty())
+                preset.description = static_cast<std::string>(node["description"]);
+            const cv::FileNode bands = node["bands"];
+            for (cv::FileNodeIterator b = bands.begin(); b != bands.end(); ++b) {
+                const cv::FileNode band = *b;
+                HueBand hb;
+                hb.hueStart = number(band["hueStart"], 0);
+                hb.hueEnd = number(band["hueEnd"], 360);
+                hb.feather = number(band["feather"], 0);
+                hb.hue = number(band["hue"], 0);
+                hb.saturation = number(band["saturation"], 0);
+                hb.lightness = number(band["lightness"], 0);
+                preset.bands.push_back(hb);
+            }
+            preset.alpha = number(node["alpha"], preset.alpha);
+            preset.gamma = number(node["gamma"], preset.gamma);
+            presets.push_back(preset);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Cannot parse " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadPreset(const std::string& path, const std::string& name, ScenePreset& preset) {
+    std::vector<ScenePreset> presets;
+    if (!readPresets(path, presets))
+        return false;
+    for (const ScenePreset& p : presets) {
+        if (p.name == name) {
+            preset = p;
+            return true;
+        }
+    }
+    std::cerr << "Unknown preset '" << name << "' in " << path << "; available:";
+    for (const ScenePreset& p : presets)
+        std::cerr << " " << p.name;
+    std::cerr << std::endl;
+    return false;
+}
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t presetLutKey(const ScenePreset& preset, const CcmModel& model, int lutSize) {
+    uint64_t hash = hashValue(kPresetCodeVersion, fnv1a(nullptr, 0));
+    hash = hashValue(lutSize, hash);
+    const HueBand band = preset.primary();
+    for (double v : {band.hue, band.saturation, band.lightness, preset.alpha, preset.gamma})
+        hash = hashValue(v, hash);
+    hash = hashValue(static_cast<int>(model.type), hash);
+    const cv::Mat coefficients = model.coefficients.isContinuous() ? model.coefficients : model.coefficients.clone();
+    return fnv1a(coefficients.data, coefficients.total() * coefficients.elemSize(), hash);
+}
+
+bool readCompiledLut(const std::string& path, uint64_t key, Lut3D& lut) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    LutFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kLutMagic, sizeof(kLutMagic)) != 0 || header.formatVersion != kLutFormatVersion ||
+        header.key != key || header.size < 2 || header.size > 256)
+        return false;
+
+    std::vector<cv::Vec3f> table(size_t(header.size) * header.size * header.size);
+    uint64_t checksum = 0;
+    if (!in.read(reinterpret_cast<char*>(table.data()), std::streamsize(table.size() * sizeof(cv::Vec3f))) ||
+        !in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum)))
+        return false;
+    if (fnv1a(table.data(), table.size() * sizeof(cv::Vec3f), fnv1a(&header, sizeof(header))) != checksum) {
+        std::cerr << "Checksum mismatch in " << path << std::endl;
+        return false;
+    }
+    lut.size = static_cast<int>(header.size);
+    lut.table = std::move(table);
+    refreshLut3D(lut);
+    return true;
+}
+
+// Written to a temporary name and renamed, so a concurrent reader never sees a partial file.
+bool writeCompiledLut(const std::string& path, uint64_t key, const Lut3D& lut) {
+    LutFileHeader header{};
+    std::memcpy(header.magic, kLutMagic, sizeof(kLutMagic));
+    header.formatVersion = kLutFormatVersion;
+    header.key = key;
+    header.size = static_cast<uint32_t>(lut.size);
+    const size_t tableBytes = lut.table.size() * sizeof(cv::Vec3f);
+    const uint64_t checksum = fnv1a(lut.table.data(), tableBytes, fnv1a(&header, sizeof(header)));
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(lut.table.data()), std::streamsize(tableBytes));
+        out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+Lut3D cachedLut(const std::string& cacheDir, const std::string& name, uint64_t key,
+                const std::function<Lut3D()>& build) {
+    CCM_TRACE_SCOPE("cachedLut");
+    std::ostringstream file;
+    file << cacheDir << "/" << name << "-" << std::hex << std::setw(16) << std::setfill('0') << key << ".lut";
+    const std::string path = file.str();
+
+    Lut3D lut;
+    if (readCompiledLut(path, key, lut)) {
+        std::cout << "LUT loaded from cache: " << path << std::endl;
+        return lut;
+    }
+    lut = build();
+    if (lut.empty())
+        return lut;
+    std::error_code ec;
+    fs::create_directories(cacheDir, ec);
+    if (!ec && writeCompiledLut(path, key, lut))   // best effort; the cache may be read-only
+        std::cout << "LUT cached at: " << path << std::endl;
+    return lut;
+}
@@ -0,0 +1,48 @@
+#ifndef PRESETS_H
+#define PRESETS_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ccm_model.hpp"
+#include "lut3d.hpp"
+#include "selective_color.hpp"
+
+// Scene presets (ref/presets.yml): the hand-tuned H/S/L values per scene, read
+// with cv::FileStorage. See the comment at the top of the file for the fields.
+struct ScenePreset {
+    std::string name, description;
+    std::vector<HueBand> bands;   // process_image uses the first, applyhsl2video all
+    double alpha = 0.95;
+    double gamma = 1.2;
+
+    // Offsets of the first band (the whole-frame adjustment), or zeros.
+    HueBand primary() const { return bands.empty() ? HueBand() : bands.front(); }
+};
+
+bool readPresets(const std::string& path, std::vector<ScenePreset>& presets);
+// Prints the available names when `name` is not in the file.
+bool loadPreset(const std::string& path, const std::string& name, ScenePreset& preset);
+
+// 64-bit FNV-1a; chain calls by passing the previous result as `hash`.
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+// Cache key of a preset's compiled LUT: every parameter that goes into the bake,
+// the CCM coefficients themselves (so a recalibration invalidates it), the LUT
+// size and a code version bumped whenever the baked chain changes.
+uint64_t presetLutKey(const ScenePreset& preset, const CcmModel& model, int lutSize);
+
+// Compiled LUTs live in cacheDir/<name>-<key>.lut: a small header (magic, format
+// version, key, size), the float table and an FNV-1a checksum of both. A file
+// with another key is never read, so stale entries simply stop being used.
+bool readCompiledLut(const std::string& path, uint64_t key, Lut3D& lut);
+bool writeCompiledLut(const std::string& path, uint64_t key, const Lut3D& lut);
+
+// The cached LUT for `key` if present, otherwise build() (stored best effort).
+Lut3D cachedLut(const std::string& cacheDir, const std::string& name, uint64_t key,
+                const std::function<Lut3D()>& build);
+
+#endif // PRESETS_H
@@ -0,0 +1,272 @@
+#include "raw_pipe.hpp"
+#include "trace.hpp"
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+
+namespace {
+
+// Reads until n bytes or end of stream; returns the byte count.
+size_t readFully(int fd, void* buf, size_t n) {
+    uchar* p = static_cast<uchar*>(buf);
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = ::read(fd, p + got, n - got);
+        if (r > 0)
+            got += r;
+        else if (r == 0 || errno != EINTR)
+            break;
+    }
+    return got;
+}
+
+bool writeFully(int fd, iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t w = ::writev(fd, iov, count);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        size_t done = w;
+        while (count > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uchar*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+// One header line (without the newline); false at end of stream.
+bool readLine(int fd, std::string& line, size_t maxLength = 4096) {
+    line.clear();
+    char c;
+    while (line.size() < maxLength) {
+        if (readFully(fd, &c, 1) != 1)
+            return false;
+        if (c == '\n')
+            return true;
+        line += c;
+    }
+    return false;
+}
+
+// A frame is read in a few large read()s only if the pipe can hold that much.
+void growPipe(int fd) {
+#ifdef F_SETPIPE_SZ
+    fcntl(fd, F_SETPIPE_SZ, 1 << 20);
+#else
+    (void)fd;
+#endif
+}
+
+} // namespace
+
+bool parseRawFormat(const std::string& name, RawFormat& format) {
+    if (name == "y4m") {
+        format = RawFormat::Y4m;
+        return true;
+    }
+    if (name == "bgr24" || name == "raw") {
+        format = RawFormat::Bgr24;
+        return true;
+    }
+    return false;
+}
+
+bool parseRawPipeArgument(int argc, const char* argv[], int& i, RawPipeOptions& options) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+        return false;
+    std::string value = argv[i + 1];
+    if (arg == "--pipe-in") {
+        if (!parseRawFormat(value, options.input))
+            return false;
+        options.enabled = true;
+    } else if (arg == "--pipe-out") {
+        if (!parseRawFormat(value, options.output))
+            return false;
+        options.outputSet = true;
+    } else if (arg == "--size") {
+        int w = 0, h = 0;
+        if (std::sscanf(value.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+            return false;
+        options.size = cv::Size(w, h);
+    } else if (arg == "--fps") {
+        if (value.find(':') != std::string::npos)
+            options.frameRate = value;
+        else
+            options.frameRate = std::to_string(std::lround(std::stod(value) * 1000)) + ":1000";
+    } else {
+        return false;
+    }
+    i++;
+    return true;
+}
+
+void reserveStdoutForFrames() {
+    std::cout.rdbuf(std::cerr.rdbuf());
+}
+
+bool RawFrameReader::open(const RawPipeOptions& options) {
+    format_ = options.input;
+    frameRate_ = options.frameRate;
+    growPipe(fd_);
+    if (format_ == RawFormat::Bgr24) {
+        if (options.size.area() <= 0) {
+            std::cerr << "bgr24 input needs --size WxH" << std::endl;
+            return false;
+        }
+        size_ = options.size;
+        return true;
+    }
+
+    std::string header;
+    if (!readLine(fd_, header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        std::cerr << "Input is not a YUV4MPEG2 stream" << std::endl;
+        return false;
+    }
+    std::istringstream tokens(header.substr(10));
+    std::string token;
+    while (tokens >> token) {
+        const std::string value = token.substr(1);
+        switch (token[0]) {
+        case 'W': size_.width = std::atoi(value.c_str()); break;
+        case 'H': size_.height = std::atoi(value.c_str()); break;
+        case 'F': frameRate_ = value; break;
+        case 'A': aspect_ = value; break;
+        case 'C':
+            // 8-bit 4:2:0 only; the chroma siting variants share the plane layout.
+            if (value != "420" && value != "420jpeg" && value != "420mpeg2" && value != "420paldv") {
+                std::cerr << "Unsupported Y4M colour space C" << value << " (use -pix_fmt yuv420p)" << std::endl;
+                return false;
+            }
+            break;
+        default: break;
+        }
+    }
+    if (size_.width <= 0 || size_.height <= 0 || size_.width % 2 || size_.height % 2) {
+        std::cerr << "Y4M frames must have a positive, even size" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RawFrameReader::read(cv::Mat& frame) {
+    if (format_ == RawFormat::Bgr24) {
+        frame.create(size_, CV_8UC3);   // the ring slot: no allocation in steady state
+        CV_Assert(frame.isContinuous());
+        const size_t bytes = frame.total() * frame.elemSize();
+        const size_t got = readFully(fd_, frame.data, bytes);
+        if (got != 0 && got != bytes)
+            std::cerr << "Truncated frame at end of input (" << got << " of " << bytes << " bytes)" << std::endl;
+        return got == bytes;
+    }
+
+    // "FRAME\n" unless the frame carries parameters, which are skipped.
+    char tag[6];
+    const size_t got = readFully(fd_, tag, sizeof(tag));
+    if (got == 0)
+        return false;
+    if (got != sizeof(tag) || std::memcmp(tag, "FRAME", 5) != 0) {
+        std::cerr << "Malformed Y4M frame header" << std::endl;
+        return false;
+    }
+    std::string params;
+    if (tag[5] != '\n' && !readLine(fd_, params))
+        return false;
+
+    yuv_.create(size_.height * 3 / 2, size_.width, CV_8UC1);
+    const size_t bytes = yuv_.total();
+    if (readFully(fd_, yuv_.data, bytes) != bytes) {
+        std::cerr << "Truncated frame at end of input" << std::endl;
+        return false;
+    }
+    cv::cvtColor(yuv_, frame, cv::COLOR_YUV2BGR_I420);
+    return true;
+}
+
+bool RawFrameWriter::open(RawFormat format, cv::Size size, const std::string& frameRate, const std::string& aspect) {
+    // A downstream process exiting must surface as a write error, not kill us.
+    std::signal(SIGPIPE, SIG_IGN);
+    format_ = format;
+    size_ = size;
+    growPipe(fd_);
+    if (format_ == RawFormat::Bgr24)
+        return true;
+    if (size.width % 2 || size.height % 2) {
+        std::cerr << "Y4M output needs an even frame size" << std::endl;
+        return false;
+    }
+    std::string header = "YUV4MPEG2 W" + std::to_string(size.width) + " H" + std::to_string(size.height) +
+                         " F" + frameRate + " Ip A" + aspect + " C420jpeg\n";
+    iovec iov{const_cast<char*>(header.data()), header.size()};
+    return writeFully(fd_, &iov, 1);
+}
+
+void RawFrameWriter::write(const cv::Mat& frame) {
+    CV_Assert(frame.type() == CV_8UC3 && frame.size() == size_);
+    bool ok = true;
+    if (format_ == RawFormat::Bgr24) {
+        if (frame.isContinuous()) {
+            iovec iov{frame.data, frame.total() * frame.elemSize()};
+            ok = writeFully(fd_, &iov, 1);
+        } else {
+            for (int y = 0; ok && y < frame.rows; y++) {
+                iovec iov{const_cast<uchar*>(frame.ptr(y)), frame.cols * frame.elemSize()};
+                ok = writeFully(fd_, &iov, 1);
+            }
+        }
+    } else {
+        cv::cvtColor(frame, yuv_, cv::COLOR_BGR2YUV_I420);
+        static const char tag[] = "FRAME\n";
+        iovec iov[2] = {{const_cast<char*>(tag), 6}, {yuv_.data, yuv_.total()}};
+        ok = writeFully(fd_, iov, 2);
+    }
+    if (!ok)
+        throw std::runtime_error(std::string("writing frames failed: ") + std::strerror(errno));
+}
+
+bool runRawPipe(const RawPipeOptions& options, const FrameOp& op, PipelineStats* stats) {
+    RawFrameReader reader;
+    RawFrameWriter writer;
+    if (!reader.open(options) ||
+        !writer.open(options.outputSet ? options.output : options.input, reader.size(), reader.frameRate(), reader.aspect()))
+        return false;
+
+    PipelineOptions pipelineOptions;
+    pipelineOptions.frameSize = reader.size();
+    try {
+        PipelineStats result = runFramePipeline(
+            [&](cv::Mat& frame) {
+                CCM_TRACE_SCOPE("pipe.read");
+                return reader.read(frame);
+            },
+            op,
+            [&](const cv::Mat& frame) {
+                CCM_TRACE_SCOPE("pipe.write");
+                writer.write(frame);
+            },
+            pipelineOptions);
+        printPipelineStats(std::cerr, result);
+        if (stats)
+            *stats = result;
+    } catch (const std::exception& e) {
+        std::cerr << "Pipe stopped: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
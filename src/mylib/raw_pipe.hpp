@@ -0,0 +1,81 @@
+#ifndef RAW_PIPE_H
+#define RAW_PIPE_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <unistd.h>
+
+#include "frame_pipeline.hpp"
+
+// Uncompressed frame streams over pipes, so a tool can sit between two ffmpeg
+// processes as a filter:
+//
+//   ffmpeg -i in.mp4 -f yuv4mpegpipe - | applyvideo2ccm --pipe-in y4m | ffmpeg -f yuv4mpegpipe -i - out.mp4
+//   ffmpeg -i in.mp4 -f rawvideo -pix_fmt bgr24 - | applyvideo2ccm --pipe-in bgr24 --size 1920x1080 | ...
+//
+// bgr24 frames are read straight into the pipeline's preallocated ring slots and
+// written straight from them; Y4M (4:2:0 only, BT.601 limited range as in
+// cv::COLOR_YUV2BGR_I420) goes through one reused plane buffer per direction.
+
+enum class RawFormat { Bgr24, Y4m };
+
+bool parseRawFormat(const std::string& name, RawFormat& format);
+
+struct RawPipeOptions {
+    bool enabled = false;
+    RawFormat input = RawFormat::Y4m;
+    RawFormat output = RawFormat::Y4m;
+    bool outputSet = false;      // otherwise output = input
+    cv::Size size;               // required for bgr24 input
+    std::string frameRate = "30:1";   // Y4M output from bgr24 input; Y4M input passes its own through
+};
+
+// Handles --pipe-in <y4m|bgr24>, --pipe-out <y4m|bgr24>, --size WxH and --fps n[:d]
+// at argv[i] (advancing i past the value). False if argv[i] is not one of them.
+bool parseRawPipeArgument(int argc, const char* argv[], int& i, RawPipeOptions& options);
+
+// Frames on stdout: route std::cout (progress, stats, line-protocol metrics) to stderr.
+void reserveStdoutForFrames();
+
+class RawFrameReader {
+public:
+    explicit RawFrameReader(int fd = STDIN_FILENO) : fd_(fd) {}
+
+    // Reads the Y4M stream header; bgr24 streams take the size from the options.
+    bool open(const RawPipeOptions& options);
+    cv::Size size() const { return size_; }
+    const std::string& frameRate() const { return frameRate_; }
+    const std::string& aspect() const { return aspect_; }
+
+    // Next frame as CV_8UC3 BGR into frame (reused when already the right size).
+    // False at end of stream; a truncated frame is reported on stderr.
+    bool read(cv::Mat& frame);
+
+private:
+    int fd_;
+    RawFormat format_ = RawFormat::Y4m;
+    cv::Size size_;
+    std::string frameRate_ = "30:1", aspect_ = "1:1";
+    cv::Mat yuv_;
+};
+
+class RawFrameWriter {
+public:
+    explicit RawFrameWriter(int fd = STDOUT_FILENO) : fd_(fd) {}
+
+    // Writes the Y4M stream header.
+    bool open(RawFormat format, cv::Size size, const std::string& frameRate, const std::string& aspect = "1:1");
+    // Throws std::runtime_error when the consumer has gone away, which stops runFramePipeline().
+    void write(const cv::Mat& frame);
+
+private:
+    int fd_;
+    RawFormat format_ = RawFormat::Y4m;
+    cv::Size size_;
+    cv::Mat yuv_;
+};
+
+// stdin -> op -> stdout through runFramePipeline(); statistics go to stderr.
+bool runRawPipe(const RawPipeOptions& options, const FrameOp& op, PipelineStats* stats = nullptr);
+
+#endif // RAW_PIPE_H
@@ -0,0 +1,95 @@
+#include "selective_color.hpp"
+#include "hsl_simd.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+bool isFullCircle(const HueBand& band) {
+    return std::fabs(band.hueEnd - band.hueStart) >= 360.0;
+}
+
+} // namespace
+
+double hueBandWeight(const HueBand& band, double h) {
+    if (isFullCircle(band))
+        return 1.0;
+
+    double start = std::fmod(std::fmod(band.hueStart, 360.0) + 360.0, 360.0);
+    double width = std::fmod(std::fmod(band.hueEnd - band.hueStart, 360.0) + 360.0, 360.0);
+    double offset = std::fmod(std::fmod(h - start, 360.0) + 360.0, 360.0);
+    if (offset <= width)
+        return 1.0;
+    if (band.feather <= 0)
+        return 0.0;
+
+    double distance = std::min(offset - width, 360.0 - offset);
+    return std::max(0.0, 1.0 - distance / band.feather);
+}
+
+SelectiveColor::SelectiveColor() : SelectiveColor(std::vector<HueBand>()) {}
+
+SelectiveColor::SelectiveColor(const std::vector<HueBand>& bands) : bands_(bands) {
+    for (int d = 0; d < 360; d++) {
+        double shift = 0, sat = 1, light = 1;
+        for (const HueBand& band : bands_) {
+            double w = hueBandWeight(band, d);
+            shift += w * band.hue;
+            sat *= 1 + w * band.saturation / 100.0;
+            light *= 1 + w * band.lightness / 100.0;
+        }
+        hueShift_[d] = static_cast<float>(shift);
+        satScale_[d] = static_cast<float>(sat);
+        lightScale_[d] = static_cast<float>(light);
+    }
+    hueShift_[360] = hueShift_[0];
+    satScale_[360] = satScale_[0];
+    lightScale_[360] = lightScale_[0];
+
+    double neutral = 1;
+    for (const HueBand& band : bands_) {
+        if (isFullCircle(band))
+            neutral *= 1 + band.lightness / 100.0;
+    }
+    neutralLight_ = static_cast<float>(neutral);
+}
+
+void SelectiveColor::apply(const cv::Mat& src, cv::Mat& dst) const {
+    CCM_TRACE_SCOPE("SelectiveColor::apply");
+    CV_Assert(src.type() == CV_8UC3);
+    dst.create(src.size(), src.type());
+
+    parallelRows(src.rows, [&](int rowStart, int rowEnd) {
+        // H, S, L planes of one row, kept per thread.
+        thread_local std::vector<float> planes;
+        planes.resize(size_t(src.cols) * 3);
+        float* H = planes.data();
+        float* S = H + src.cols;
+        float* L = S + src.cols;
+        for (int y = rowStart; y < rowEnd; y++) {
+            bgrRowToHsl(src.ptr<uchar>(y), H, S, L, src.cols);
+            for (int x = 0; x < src.cols; x++) {
+                int i = std::min(static_cast<int>(H[x]), 359);
+                float f = H[x] - i;
+                float shift = hueShift_[i] + f * (hueShift_[i + 1] - hueShift_[i]);
+                float sat = satScale_[i] + f * (satScale_[i + 1] - satScale_[i]);
+                float light = lightScale_[i] + f * (lightScale_[i + 1] - lightScale_[i]);
+                light = S[x] > 0 ? light : neutralLight_;
+
+                H[x] += shift;   // wrapped by hslRowToBgr
+                S[x] = std::clamp(S[x] * sat, 0.0f, 100.0f);
+                L[x] = std::clamp(L[x] * light, 0.0f, 100.0f);
+            }
+            hslRowToBgr(H, S, L, dst.ptr<uchar>(y), src.cols);
+        }
+    });
+}
+
+cv::Mat SelectiveColor::apply(const cv::Mat& src) const {
+    cv::Mat dst;
+    apply(src, dst);
+    return dst;
+}
@@ -0,0 +1,47 @@
+#ifndef SELECTIVE_COLOR_H
+#define SELECTIVE_COLOR_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// One hue band of a selective-colour adjustment.
+// [hueStart, hueEnd] is in degrees and may wrap through 0 (e.g. 330 -> 30);
+// hueStart = 0, hueEnd = 360 selects every hue, including neutral pixels.
+// Outside the range the band fades out linearly over `feather` degrees.
+// Offsets use the adjust_hsl_* convention: hue in degrees, saturation and
+// lightness in percent (s *= 1 + saturation / 100).
+struct HueBand {
+    double hueStart = 0, hueEnd = 360;
+    double feather = 0;
+    double hue = 0, saturation = 0, lightness = 0;
+};
+
+// Selective colour with any number of hue bands, applied in a single HSL round trip.
+// The bands are compiled into 360-entry per-hue tables (hue shift, saturation and
+// lightness scale); each pixel does one interpolated table lookup, so the cost does
+// not depend on the number of bands. Hue shifts add up and S/L scales multiply, so
+// the result approximates running the bands one after another: every band's weight
+// is taken at the original hue, and there is no clamping or 8-bit rounding between
+// bands.
+class SelectiveColor {
+public:
+    SelectiveColor();
+    explicit SelectiveColor(const std::vector<HueBand>& bands);
+
+    void apply(const cv::Mat& src, cv::Mat& dst) const;
+    cv::Mat apply(const cv::Mat& src) const;
+
+    const std::vector<HueBand>& bands() const { return bands_; }
+
+private:
+    std::vector<HueBand> bands_;
+    // Index 360 repeats index 0 so interpolation never wraps.
+    float hueShift_[361], satScale_[361], lightScale_[361];
+    // Pixels with no chroma have no hue; only full-circle bands change their lightness.
+    float neutralLight_;
+};
+
+// Weight of a band at hue h (degrees), in [0, 1].
+double hueBandWeight(const HueBand& band, double h);
+
+#endif // SELECTIVE_COLOR_H
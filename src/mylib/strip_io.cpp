@@ -0,0 +1,210 @@
+#include "strip_io.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Reads the next decimal header field, skipping whitespace and # comments.
+bool nextHeaderValue(const uchar* data, size_t size, size_t& pos, long& value) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n')
+                pos++;
+        } else if (std::isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= size || !std::isdigit(data[pos]))
+        return false;
+    value = 0;
+    while (pos < size && std::isdigit(data[pos]) && value < (1L << 30))
+        value = value * 10 + (data[pos++] - '0');
+    return true;
+}
+
+} // namespace
+
+bool isPpmFile(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".ppm" || ext == ".pnm";
+}
+
+bool PpmStripReader::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0) {
+        std::cerr << "Cannot open " << path << std::endl;
+        close();
+        return false;
+    }
+    mapSize_ = st.st_size;
+    void* mapped = mapSize_ > 0 ? mmap(nullptr, mapSize_, PROT_READ, MAP_PRIVATE, fd_, 0) : MAP_FAILED;
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Cannot map " << path << std::endl;
+        mapSize_ = 0;
+        close();
+        return false;
+    }
+    map_ = static_cast<uchar*>(mapped);
+    madvise(map_, mapSize_, MADV_SEQUENTIAL);
+
+    size_t pos = 2;
+    long width = 0, height = 0, maxval = 0;
+    if (mapSize_ < 3 || map_[0] != 'P' || map_[1] != '6' || !nextHeaderValue(map_, mapSize_, pos, width) ||
+        !nextHeaderValue(map_, mapSize_, pos, height) || !nextHeaderValue(map_, mapSize_, pos, maxval) ||
+        pos >= mapSize_ || !std::isspace(map_[pos])) {
+        std::cerr << "Not a binary PPM (P6): " << path << std::endl;
+        close();
+        return false;
+    }
+    dataOffset_ = pos + 1;   // exactly one whitespace byte after maxval
+    if (maxval != 255 || width <= 0 || height <= 0 ||
+        dataOffset_ + size_t(width) * height * 3 > mapSize_) {
+        std::cerr << "Unsupported or truncated PPM (8-bit only): " << path << std::endl;
+        close();
+        return false;
+    }
+    cols_ = static_cast<int>(width);
+    rows_ = static_cast<int>(height);
+    released_ = 0;
+    return true;
+}
+
+void PpmStripReader::close() {
+    if (map_)
+        munmap(map_, mapSize_);
+    if (fd_ >= 0)
+        ::close(fd_);
+    map_ = nullptr;
+    fd_ = -1;
+    mapSize_ = 0;
+    rows_ = cols_ = 0;
+}
+
+void PpmStripReader::read(int rowStart, int rowEnd, cv::Mat& dst, int rowStep) {
+    CV_Assert(map_ && 0 <= rowStart && rowStart < rowEnd && rowEnd <= rows_ && rowStep >= 1);
+    const size_t rowBytes = size_t(cols_) * 3;
+    uchar* first = map_ + dataOffset_ + rowStart * rowBytes;
+    if (rowStep == 1) {
+        cv::Mat rgb(rowEnd - rowStart, cols_, CV_8UC3, first);
+        cv::cvtColor(rgb, dst, cv::COLOR_RGB2BGR);
+        return;
+    }
+    // Every rowStep-th row: a strided header over the mapping, no copy before the conversion.
+    cv::Mat rgb((rowEnd - rowStart + rowStep - 1) / rowStep, cols_, CV_8UC3, first, rowBytes * rowStep);
+    cv::cvtColor(rgb, dst, cv::COLOR_RGB2BGR);
+}
+
+void PpmStripReader::release(int rowEnd) {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = (dataOffset_ + size_t(rowEnd) * cols_ * 3) / page * page;
+    if (end > released_) {
+        madvise(map_ + released_, end - released_, MADV_DONTNEED);
+        released_ = end;
+    }
+}
+
+PpmStripWriter::~PpmStripWriter() {
+    if (file_)
+        std::fclose(file_);
+}
+
+bool PpmStripWriter::open(const std::string& path, int rows, int cols) {
+    if (file_)
+        std::fclose(file_);
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Cannot create " << path << std::endl;
+        return false;
+    }
+    rows_ = rows;
+    cols_ = cols;
+    written_ = 0;
+    ok_ = std::fprintf(file_, "P6\n%d %d\n255\n", cols, rows) > 0;
+    return ok_;
+}
+
+bool PpmStripWriter::write(const cv::Mat& bgr) {
+    CV_Assert(file_ && bgr.type() == CV_8UC3 && bgr.cols == cols_ && written_ + bgr.rows <= rows_);
+    cv::cvtColor(bgr, rgb_, cv::COLOR_BGR2RGB);
+    const size_t bytes = rgb_.total() * rgb_.elemSize();
+    ok_ = ok_ && std::fwrite(rgb_.data, 1, bytes, file_) == bytes;
+    written_ += bgr.rows;
+    return ok_;
+}
+
+bool PpmStripWriter::close() {
+    if (!file_)
+        return false;
+    bool ok = std::fclose(file_) == 0 && ok_ && written_ == rows_;
+    file_ = nullptr;
+    return ok;
+}
+
+int stripRowsForBudget(int cols, const StripOptions& options) {
+    const size_t stripRowBytes = size_t(cols) * 3 * std::max(options.workingBuffers, 1);
+    return static_cast<int>(std::clamp<size_t>(options.memoryBudget / stripRowBytes, 1, 1 << 30));
+}
+
+bool processPpmStrips(const std::string& inPath, const std::string& outPath, const StripFn& process,
+                      const StripOptions& options) {
+    CCM_TRACE_SCOPE("processPpmStrips");
+    PpmStripReader reader;
+    PpmStripWriter writer;
+    if (!reader.open(inPath) || !writer.open(outPath, reader.rows(), reader.cols()))
+        return false;
+
+    const int stripRows = stripRowsForBudget(reader.cols(), options);
+    cv::Mat src, dst;   // reused: the same size for every strip but the last
+    for (int y = 0; y < reader.rows(); y += stripRows) {
+        CCM_TRACE_SCOPE("strip");
+        const int end = std::min(y + stripRows, reader.rows());
+        reader.read(y, end, src);
+        reader.release(end);
+        process(src, dst);
+        if (!writer.write(dst))
+            break;
+    }
+    if (!writer.close()) {
+        std::cerr << "Error writing " << outPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool sampleStripMean(const std::string& inPath, const StripFn& process, int sampleStep, cv::Scalar& mean,
+                     const StripOptions& options) {
+    CCM_TRACE_SCOPE("sampleStripMean");
+    PpmStripReader reader;
+    if (!reader.open(inPath))
+        return false;
+
+    sampleStep = std::max(sampleStep, 1);
+    const int stripRows = stripRowsForBudget(reader.cols(), options);
+    cv::Mat src, dst;
+    cv::Scalar sum = cv::Scalar::all(0);
+    double pixels = 0;
+    for (int y = 0; y < reader.rows(); y += stripRows * sampleStep) {
+        const int end = std::min(y + stripRows * sampleStep, reader.rows());
+        reader.read(y, end, src, sampleStep);
+        reader.release(end);
+        process(src, dst);
+        const double n = static_cast<double>(dst.total());
+        sum += cv::mean(dst) * n;
+        pixels += n;
+    }
+    mean = sum * (1.0 / pixels);
+    return true;
+}
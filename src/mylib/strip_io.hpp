@@ -0,0 +1,80 @@
+#ifndef STRIP_IO_H
+#define STRIP_IO_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// Row-strip access to binary PPM (P6, maxval 255) files, so images much larger
+// than RAM (stitched panoramas, orthomosaic tiles) can be corrected within a
+// fixed memory budget. The input is mmapped and the pages of rows already
+// converted are dropped again; the output is written strip by strip.
+
+bool isPpmFile(const std::string& path);
+
+class PpmStripReader {
+public:
+    PpmStripReader() = default;
+    ~PpmStripReader() { close(); }
+    PpmStripReader(const PpmStripReader&) = delete;
+    PpmStripReader& operator=(const PpmStripReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // Rows [rowStart, rowEnd) converted to BGR into dst; with rowStep > 1 only
+    // every rowStep-th of them (for sampling passes).
+    void read(int rowStart, int rowEnd, cv::Mat& dst, int rowStep = 1);
+    // Gives the mapped pages of every row before rowEnd back to the kernel.
+    void release(int rowEnd);
+
+private:
+    int fd_ = -1;
+    uchar* map_ = nullptr;
+    size_t mapSize_ = 0, dataOffset_ = 0, released_ = 0;
+    int rows_ = 0, cols_ = 0;
+};
+
+class PpmStripWriter {
+public:
+    PpmStripWriter() = default;
+    ~PpmStripWriter();
+    PpmStripWriter(const PpmStripWriter&) = delete;
+    PpmStripWriter& operator=(const PpmStripWriter&) = delete;
+
+    bool open(const std::string& path, int rows, int cols);
+    // Appends the next BGR strip.
+    bool write(const cv::Mat& bgr);
+    // False if a write failed or not every row was written.
+    bool close();
+
+private:
+    FILE* file_ = nullptr;
+    cv::Mat rgb_;
+    int rows_ = 0, cols_ = 0, written_ = 0;
+    bool ok_ = true;
+};
+
+struct StripOptions {
+    size_t memoryBudget = size_t(256) << 20;   // bytes for all strip buffers together
+    int workingBuffers = 6;   // full-width strips alive at once (input, output, operator scratch)
+};
+
+// Rows per strip so that options.workingBuffers BGR strips of `cols` fit the budget (at least 1).
+int stripRowsForBudget(int cols, const StripOptions& options);
+
+// Strip operator: src and dst are BGR strips of the same size; dst may be src.
+using StripFn = std::function<void(const cv::Mat& src, cv::Mat& dst)>;
+
+// Streams inPath to outPath (both PPM) through process, one strip at a time.
+bool processPpmStrips(const std::string& inPath, const std::string& outPath, const StripFn& process,
+                      const StripOptions& options = StripOptions());
+// Per-channel mean of process() over every sampleStep-th row, for global
+// statistics (e.g. the white balance shift) that need a pass before the output.
+bool sampleStripMean(const std::string& inPath, const StripFn& process, int sampleStep, cv::Scalar& mean,
+                     const StripOptions& options = StripOptions());
+
+#endif // STRIP_IO_H
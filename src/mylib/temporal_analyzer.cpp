@@ -0,0 +1,95 @@
+#include "temporal_analyzer.hpp"
+#include "hsl_stats.hpp"
+#include "image_ops.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+TemporalAnalyzer::TemporalAnalyzer(const TemporalAnalyzerOptions& options) : options_(options) {}
+
+void TemporalAnalyzer::reset() {
+    applied_ = VideoAdjustments();
+    primed_ = false;
+    haveHistogram_ = false;
+    sinceAnalysis_ = 0;
+}
+
+const VideoAdjustments& TemporalAnalyzer::update(const cv::Mat& frame) {
+    CCM_TRACE_SCOPE("TemporalAnalyzer::update");
+    CV_Assert(frame.type() == CV_8UC3 && !frame.empty());
+    frames_++;
+    if (detectSceneCut(frame)) {
+        sceneCuts_++;
+        analyze(frame, true);
+    } else if (!primed_ || ++sinceAnalysis_ >= static_cast<uint64_t>(std::max(options_.analyzeEvery, 1))) {
+        analyze(frame, !primed_);
+    }
+    return applied_;
+}
+
+bool TemporalAnalyzer::detectSceneCut(const cv::Mat& frame) {
+    // 64x36 samples at cell centres: a few thousand pixels whatever the resolution.
+    const int gridX = 64, gridY = 36;
+    std::array<float, kLumaBins> histogram{};
+    for (int j = 0; j < gridY; j++) {
+        const cv::Vec3b* row = frame.ptr<cv::Vec3b>((2 * j + 1) * frame.rows / (2 * gridY));
+        for (int i = 0; i < gridX; i++) {
+            const cv::Vec3b& p = row[(2 * i + 1) * frame.cols / (2 * gridX)];
+            const int luma = (29 * p[0] + 150 * p[1] + 77 * p[2]) >> 8;
+            histogram[luma * kLumaBins / 256] += 1.0f / (gridX * gridY);
+        }
+    }
+
+    bool cut = false;
+    if (haveHistogram_) {
+        float distance = 0;
+        for (int b = 0; b < kLumaBins; b++)
+            distance += std::abs(histogram[b] - lumaHistogram_[b]);
+        cut = distance / 2 > options_.sceneCutThreshold;
+    }
+    lumaHistogram_ = histogram;
+    haveHistogram_ = true;
+    return cut;
+}
+
+void TemporalAnalyzer::analyze(const cv::Mat& frame, bool snap) {
+    CCM_TRACE_SCOPE("TemporalAnalyzer::analyze");
+    analyses_++;
+    sinceAnalysis_ = 0;
+
+    const int width = std::min(options_.proxyWidth, frame.cols);
+    const int height = std::max(1, static_cast<int>(std::lround(frame.rows * double(width) / frame.cols)));
+    cv::resize(frame, proxy_, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+
+    HslStats stats = computeHslStats(proxy_);
+    const double saturation = stats.percentile(1, 0.5);
+    const double lightness = stats.percentile(2, 0.5);
+    cv::cvtColor(proxy_, lab_, cv::COLOR_BGR2Lab);
+    const cv::Scalar labMean = cv::mean(lab_);
+
+    if (snap || !primed_) {
+        saturation_ = saturation;
+        lightness_ = lightness;
+        labMean_ = labMean;
+        primed_ = true;
+    } else {
+        const double a = options_.smoothing;
+        saturation_ += a * (saturation - saturation_);
+        lightness_ += a * (lightness - lightness_);
+        labMean_ += (labMean - labMean_) * a;
+    }
+
+    int hue, sat, light;
+    determineHSLAdjustments(std::vector<double>{0, saturation_, lightness_}, std::vector<double>(3, 0.0), hue, sat, light);
+    applied_.hue = hue;
+    if (snap || std::abs(sat - applied_.saturation) >= options_.hslHysteresis)
+        applied_.saturation = sat;
+    if (snap || std::abs(light - applied_.lightness) >= options_.hslHysteresis)
+        applied_.lightness = light;
+
+    const cv::Scalar shift = whiteBalanceShift(labMean_);
+    if (snap || std::abs(shift[1] - applied_.labShift[1]) >= options_.wbHysteresis ||
+        std::abs(shift[2] - applied_.labShift[2]) >= options_.wbHysteresis)
+        applied_.labShift = shift;
+}
@@ -0,0 +1,60 @@
+#ifndef TEMPORAL_ANALYZER_H
+#define TEMPORAL_ANALYZER_H
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+
+struct TemporalAnalyzerOptions {
+    int analyzeEvery = 10;            // frames between two statistics passes
+    int proxyWidth = 256;             // statistics run on a frame downscaled to this width
+    double smoothing = 0.15;          // EMA weight of each new measurement
+    int hslHysteresis = 2;            // S/L adjustments (percent) change only by at least this much
+    double wbHysteresis = 0.75;       // white balance shift (Lab units) likewise
+    double sceneCutThreshold = 0.4;   // luma histogram distance in [0, 1] that counts as a cut
+};
+
+// Auto-HSL offsets (adjust_hsl convention) and the Lab shift for
+// adjustWhiteBalance(src, dst, labShift).
+struct VideoAdjustments {
+    int hue = 0, saturation = 0, lightness = 0;
+    cv::Scalar labShift;
+};
+
+// Auto-HSL and white balance for video without a full-resolution statistics
+// pass per frame. Every frame only feeds a sparse 64x36 pixel grid to the scene
+// cut detector; every analyzeEvery frames the frame is downscaled and measured
+// (S/L medians, Lab mean). Measurements are smoothed with an EMA and the applied
+// adjustments follow with hysteresis, so they do not flicker. A scene cut
+// analyses the frame at once and drops the smoothed history.
+class TemporalAnalyzer {
+public:
+    explicit TemporalAnalyzer(const TemporalAnalyzerOptions& options = TemporalAnalyzerOptions());
+
+    // Call for every frame, in order; returns the adjustments for this frame.
+    const VideoAdjustments& update(const cv::Mat& frame);
+    const VideoAdjustments& current() const { return applied_; }
+    void reset();
+
+    uint64_t frames() const { return frames_; }
+    uint64_t analyses() const { return analyses_; }
+    uint64_t sceneCuts() const { return sceneCuts_; }
+
+private:
+    static const int kLumaBins = 32;
+
+    bool detectSceneCut(const cv::Mat& frame);
+    void analyze(const cv::Mat& frame, bool snap);
+
+    TemporalAnalyzerOptions options_;
+    VideoAdjustments applied_;
+    bool primed_ = false;
+    double saturation_ = 0, lightness_ = 0;   // smoothed S/L medians
+    cv::Scalar labMean_;                      // smoothed Lab mean
+    std::array<float, kLumaBins> lumaHistogram_{};
+    bool haveHistogram_ = false;
+    cv::Mat proxy_, lab_;
+    uint64_t frames_ = 0, analyses_ = 0, sceneCuts_ = 0, sinceAnalysis_ = 0;
+};
+
+#endif // TEMPORAL_ANALYZER_H
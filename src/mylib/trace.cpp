@@ -0,0 +1,174 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceEvent {
+    const char* name;
+    int64_t startNs, durationNs, frame;
+};
+
+// Written only by its own thread; count is published with release so a
+// writer that runs after the thread went idle sees complete events.
+struct ThreadBuffer {
+    int tid = 0;
+    std::string name;
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> count{0};
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::string path;
+    size_t eventsPerThread = 1 << 16;
+    Clock::time_point origin = Clock::now();
+};
+
+std::atomic<bool> enabled{false};
+
+TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+void writeAtExit() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        path = registry().path;
+    }
+    if (!path.empty() && traceWrite(path))
+        std::cerr << "Trace saved at: " << path << std::endl;
+}
+
+// Picks up CCM_TRACE_FILE before main() so every tool is traceable without code changes.
+[[maybe_unused]] const bool startedFromEnv = [] {
+    if (const char* path = std::getenv("CCM_TRACE_FILE")) {
+        const char* events = std::getenv("CCM_TRACE_EVENTS");
+        traceStart(path, events ? static_cast<size_t>(std::atoll(events)) : 1 << 16);
+        return true;
+    }
+    return false;
+}();
+
+thread_local std::string threadName;
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer& currentBuffer() {
+    if (!threadBuffer) {
+        TraceRegistry& reg = registry();
+        auto buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffer->tid = static_cast<int>(reg.buffers.size()) + 1;
+        buffer->name = threadName;
+        buffer->events.resize(std::max<size_t>(1, reg.eventsPerThread));
+        reg.buffers.push_back(buffer);
+        threadBuffer = buffer;
+    }
+    return *threadBuffer;
+}
+
+void writeEscaped(std::ostream& os, const std::string& text) {
+    os << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+} // namespace
+
+void traceStart(const std::string& path, size_t eventsPerThread) {
+    TraceRegistry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.path = path;
+        reg.eventsPerThread = eventsPerThread;
+    }
+    // Registered after registry() is constructed, so it runs before the registry is destroyed.
+    static const bool atExitRegistered = (std::atexit(writeAtExit), true);
+    (void)atExitRegistered;
+    enabled.store(true, std::memory_order_release);
+}
+
+bool traceEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void traceThreadName(const char* name) {
+    threadName = name;
+    if (threadBuffer) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        threadBuffer->name = threadName;
+    }
+}
+
+void TraceScope::record() {
+    Clock::time_point end = Clock::now();
+    ThreadBuffer& buffer = currentBuffer();
+    const uint64_t n = buffer.count.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer.events[n % buffer.events.size()];
+    event.name = name_;
+    event.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start_ - registry().origin).count();
+    event.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+    event.frame = frame_;
+    buffer.count.store(n + 1, std::memory_order_release);
+}
+
+bool traceWrite(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error opening the trace file: " << path << std::endl;
+        return false;
+    }
+
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&] {
+        if (!first)
+            out << ",\n";
+        first = false;
+    };
+
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const auto& buffer : reg.buffers) {
+        if (!buffer->name.empty()) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+            writeEscaped(out, buffer->name);
+            out << "}}";
+        }
+
+        // The ring keeps the newest events; walk it oldest first.
+        const uint64_t count = buffer->count.load(std::memory_order_acquire);
+        const uint64_t size = buffer->events.size();
+        for (uint64_t i = count > size ? count - size : 0; i < count; i++) {
+            const TraceEvent& event = buffer->events[i % size];
+            separator();
+            out << "{\"name\":";
+            writeEscaped(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << event.startNs / 1e3 << ",\"dur\":" << event.durationNs / 1e3;
+            if (event.frame >= 0)
+                out << ",\"args\":{\"frame\":" << event.frame << "}";
+            out << "}";
+        }
+    }
+    out << "]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped trace spans exported as Chrome trace JSON (chrome://tracing, Perfetto).
+//
+//   CCM_TRACE_SCOPE("ccm");               // span until the end of the block
+//   CCM_TRACE_FRAME("decode", frameIndex); // same, tagged with a frame number
+//
+// Spans go to a fixed-size ring per thread (the oldest events are overwritten),
+// so recording costs two clock reads and a store, with no locks. Recording starts
+// when CCM_TRACE_FILE is set, or after traceStart(); the file is written at exit.
+// Configure with -DCCM_ENABLE_TRACE=OFF to compile every span away.
+
+// Start recording; events are written to `path` at exit (or by traceWrite()).
+void traceStart(const std::string& path, size_t eventsPerThread = 1 << 16);
+bool traceEnabled();
+// Names the calling thread in the trace viewer.
+void traceThreadName(const char* name);
+// Writes everything recorded so far. Call while the traced threads are idle.
+bool traceWrite(const std::string& path);
+
+class TraceScope {
+public:
+    // `name` must be a string literal (or otherwise outlive the trace).
+    explicit TraceScope(const char* name, int64_t frame = -1)
+        : name_(traceEnabled() ? name : nullptr), frame_(frame) {
+        if (name_)
+            start_ = std::chrono::steady_clock::now();
+    }
+    ~TraceScope() {
+        if (name_)
+            record();
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    void record();
+
+    const char* name_;
+    int64_t frame_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define CCM_TRACE_CONCAT_(a, b) a##b
+#define CCM_TRACE_CONCAT(a, b) CCM_TRACE_CONCAT_(a, b)
+
+#if CCM_TRACE
+#define CCM_TRACE_SCOPE(name) TraceScope CCM_TRACE_CONCAT(ccmTraceScope, __LINE__)(name)
+#define CCM_TRACE_FRAME(name, frame) TraceScope CCM_TRACE_CONCAT(ccmTraceScope, __LINE__)(name, static_cast<int64_t>(frame))
+#define CCM_TRACE_THREAD(name) traceThreadName(name)
+#else
+#define CCM_TRACE_SCOPE(name) ((void)0)
+#define CCM_TRACE_FRAME(name, frame) ((void)(frame))
+#define CCM_TRACE_THREAD(name) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,94 @@
+#include "white_balance.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+namespace {
+
+// BGR (sRGB primaries) -> Bradford LMS, in the row layout: lms = bgr * kBgrToLms.
+// Rows are the B, G, R inputs of Bradford * sRGB-to-XYZ.
+const cv::Matx33f kBgrToLms(0.0274f, 0.0232f, 0.9807f,
+                            0.4914f, 0.9616f, 0.0876f,
+                            0.4227f, 0.0556f, 0.0214f);
+
+float luminance(const cv::Vec3f& bgr) {
+    return 0.0722f * bgr[0] + 0.7152f * bgr[1] + 0.2126f * bgr[2];
+}
+
+// target / measured, kept finite for a near-black or single-colour frame.
+float adaptationGain(float target, float measured) {
+    return measured > 1e-3f ? std::clamp(target / measured, 0.25f, 4.0f) : 1.0f;
+}
+
+} // namespace
+
+bool parseWhiteBalanceMode(const std::string& name, WhiteBalanceMode& mode) {
+    for (WhiteBalanceMode m : {WhiteBalanceMode::None, WhiteBalanceMode::Lab, WhiteBalanceMode::GrayWorld,
+                               WhiteBalanceMode::VonKries}) {
+        if (name == whiteBalanceModeName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* whiteBalanceModeName(WhiteBalanceMode mode) {
+    switch (mode) {
+    case WhiteBalanceMode::None: return "none";
+    case WhiteBalanceMode::Lab: return "lab";
+    case WhiteBalanceMode::GrayWorld: return "grayworld";
+    case WhiteBalanceMode::VonKries: return "vonkries";
+    }
+    return "none";
+}
+
+cv::Vec3f estimateIlluminant(const cv::Mat& img, const CcmModel& model) {
+    CCM_TRACE_SCOPE("estimateIlluminant");
+    CV_Assert(img.type() == CV_8UC3 && !img.empty());
+    if (model.type == CcmModelType::Linear3x3) {
+        // The mean commutes with a linear map.
+        cv::Scalar mean = cv::mean(img);
+        cv::Matx13f m(float(mean[0]), float(mean[1]), float(mean[2]));
+        cv::Matx13f out = m * model.matrix();
+        return cv::Vec3f(out(0), out(1), out(2));
+    }
+
+    const int grid = 64;
+    cv::Vec3f sum(0, 0, 0);
+    for (int j = 0; j < grid; j++) {
+        const cv::Vec3b* row = img.ptr<cv::Vec3b>((2 * j + 1) * img.rows / (2 * grid));
+        for (int i = 0; i < grid; i++) {
+            const cv::Vec3b& p = row[(2 * i + 1) * img.cols / (2 * grid)];
+            cv::Vec3f out = evalCcmModel(model, cv::Vec3f(p[0], p[1], p[2]));
+            for (int c = 0; c < 3; c++)
+                sum[c] += std::clamp(out[c], 0.0f, 255.0f);
+        }
+    }
+    return sum * (1.0f / (grid * grid));
+}
+
+cv::Matx33f whiteBalanceMatrix(WhiteBalanceMode mode, const cv::Vec3f& illuminant) {
+    const float grey = luminance(illuminant);
+    if (mode == WhiteBalanceMode::GrayWorld) {
+        cv::Matx33f W = cv::Matx33f::zeros();
+        for (int c = 0; c < 3; c++)
+            W(c, c) = adaptationGain(grey, illuminant[c]);
+        return W;
+    }
+    if (mode == WhiteBalanceMode::VonKries) {
+        cv::Matx13f measured = cv::Matx13f(illuminant[0], illuminant[1], illuminant[2]) * kBgrToLms;
+        cv::Matx13f target = cv::Matx13f(grey, grey, grey) * kBgrToLms;
+        cv::Matx33f D = cv::Matx33f::zeros();
+        for (int c = 0; c < 3; c++)
+            D(c, c) = adaptationGain(target(c), measured(c));
+        return kBgrToLms * D * kBgrToLms.inv();
+    }
+    return cv::Matx33f::eye();
+}
+
+CcmModel foldWhiteBalance(const CcmModel& model, const cv::Matx33f& W) {
+    CcmModel folded;
+    folded.type = model.type;
+    folded.coefficients = model.coefficients * cv::Mat(W);
+    return folded;
+}
@@ -0,0 +1,34 @@
+#ifndef WHITE_BALANCE_H
+#define WHITE_BALANCE_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#include "ccm_model.hpp"
+
+// White balance modes of the image tools.
+//   Lab        reference: shift the Lab a/b means to neutral after the other
+//              stages (adjustWhiteBalance, two colour conversions per image)
+//   GrayWorld  per-channel gains that make the mean colour grey
+//   VonKries   the same adaptation done on cone responses (Bradford LMS)
+// GrayWorld and VonKries are 3x3 matrices composed into the CCM, so applying
+// them costs nothing beyond the CCM pass itself.
+enum class WhiteBalanceMode { None, Lab, GrayWorld, VonKries };
+
+bool parseWhiteBalanceMode(const std::string& name, WhiteBalanceMode& mode);
+const char* whiteBalanceModeName(WhiteBalanceMode mode);
+
+// Gray-world illuminant: the mean BGR colour of img after `model`. For a linear
+// model this is mean(img) * M, a single reduction over the input; other models
+// are evaluated on a 64x64 sample grid.
+cv::Vec3f estimateIlluminant(const cv::Mat& img, const CcmModel& model);
+
+// Correction in the CCM layout (dst = src * W) taking `illuminant` to the grey of
+// the same luminance. Identity for None and Lab.
+cv::Matx33f whiteBalanceMatrix(WhiteBalanceMode mode, const cv::Vec3f& illuminant);
+
+// `model` followed by W, as a single model of the same type (W recombines the
+// output columns, so this holds for every model order).
+CcmModel foldWhiteBalance(const CcmModel& model, const cv::Matx33f& W);
+
+#endif // WHITE_BALANCE_H
@@ -5,246 +5,317 @@
 #include <chrono>
 #include <filesystem>
 #include <string>
+#include <cctype>
+
+#include "mylib/hsl.hpp"
+#include "mylib/lut3d.hpp"
+#include "mylib/ccm_model.hpp"
+#include "mylib/image_ops.hpp"
+#include "mylib/batch_processor.hpp"
+#include "mylib/strip_io.hpp"
+#include "mylib/white_balance.hpp"
+#include "mylib/presets.hpp"
+#include "mylib/metrics.hpp"
+#include "mylib/trace.hpp"
 
 using namespace std;
 namespace fs = std::filesystem;
 
-struct HSL {
-    double h, s, l;
-};
-
-HSL rgb_to_hsl(double r, double g, double b) {
-    r /= 255.0;
-    g /= 255.0;
-    b /= 255.0;
-    double cmax = std::max({r, g, b});
-    double cmin = std::min({r, g, b});
-    double diff = cmax - cmin;
-
-    HSL result;
-    result.l = (cmax + cmin) / 2;
-
-    if (cmax == cmin) {
-        result.h = result.s = 0;
-    } else {
-        result.s = result.l <= 0.5 ? diff / (cmax + cmin) : diff / (2.0 - cmax - cmin);
-        
-        if (cmax == r) {
-            result.h = (g - b) / diff + (g < b ? 6 : 0);
-        } else if (cmax == g) {
-            result.h = (b - r) / diff + 2;
-        } else {
-            result.h = (r - g) / diff + 4;
+// Bake adjust_hsl -> CCM -> brightness -> gamma into one 3D LUT.
+// Each stage is evaluated exactly as the per-frame path does (including the 8-bit
+// rounding between stages), so the LUT reproduces the reference chain at every grid node.
+Lut3D buildPipelineLut(double hue, double saturation, double lightness,
+                       const CcmModel& model, double alpha, float gamma, int size) {
+    uchar gammaTable[256];
+    for (int i = 0; i < 256; ++i)
+        gammaTable[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
+
+    return bakeLut3D([&](const cv::Vec3f& bgr) {
+        HSL hsl = rgb_to_hsl(bgr[2], bgr[1], bgr[0]);
+        hsl.h = std::fmod(hsl.h + hue, 360.0);
+        hsl.s = std::clamp(hsl.s * (1 + saturation / 100), 0.0, 100.0);
+        hsl.l = std::clamp(hsl.l * (1 + lightness / 100), 0.0, 100.0);
+        cv::Vec3b p = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
+
+        cv::Vec3f corrected = evalCcmModel(model, cv::Vec3f(p[0], p[1], p[2]));
+        cv::Vec3f out;
+        for (int c = 0; c < 3; c++) {
+            uchar v = cv::saturate_cast<uchar>(corrected[c]);
+            v = cv::saturate_cast<uchar>(v * alpha);
+            out[c] = gammaTable[v];
         }
-        result.h *= 60;
-    }
-
-    result.s *= 100;
-    result.l *= 100;
-    return result;
+        return out;
+    }, size);
 }
 
-cv::Vec3b hsl_to_rgb(double h, double s, double l) {
-    s /= 100;
-    l /= 100;
-    
-    auto hue_to_rgb = [](double p, double q, double t) {
-        if (t < 0) t += 1;
-        if (t > 1) t -= 1;
-        if (t < 1.0/6) return p + (q - p) * 6 * t;
-        if (t < 1.0/2) return q;
-        if (t < 2.0/3) return p + (q - p) * (2.0/3 - t) * 6;
-        return p;
-    };
-
-    if (s == 0) {
-        return cv::Vec3b(l * 255, l * 255, l * 255);
-    } else {
-        double q = l < 0.5 ? l * (1 + s) : l + s - l * s;
-        double p = 2 * l - q;
-        double r = hue_to_rgb(p, q, h / 360.0 + 1.0/3);
-        double g = hue_to_rgb(p, q, h / 360.0);
-        double b = hue_to_rgb(p, q, h / 360.0 - 1.0/3);
-        return cv::Vec3b(b * 255, g * 255, r * 255);
-    }
-}
-
-void adjust_hsl(const std::string& input_path, const std::string& output_path, double hue, double saturation, double lightness) {
-    cv::Mat img = cv::imread(input_path);
-    if (img.empty()) {
-        std::cerr << "Error: Could not read the image." << std::endl;
-        return;
-    }
-
-    cv::Mat result = img.clone();
-    for (int y = 0; y < img.rows; y++) {
-        for (int x = 0; x < img.cols; x++) {
-            cv::Vec3b pixel = img.at<cv::Vec3b>(y, x);
-            HSL hsl = rgb_to_hsl(pixel[2], pixel[1], pixel[0]);  // OpenCV uses BGR
-
-            hsl.h = std::fmod(hsl.h + hue, 360.0);
-            hsl.s = std::clamp(hsl.s * (1 + saturation / 100), 0.0, 100.0);
-            hsl.l = std::clamp(hsl.l * (1 + lightness / 100), 0.0, 100.0);
-
-            result.at<cv::Vec3b>(y, x) = hsl_to_rgb(hsl.h, hsl.s, hsl.l);
-        }
-    }
-
-    cv::imwrite(output_path, result);
-    std::cout << "Adjusted image saved at: " << output_path << std::endl;
-    // return result;
+// HSL and CCM chained in memory: each image is decoded once and encoded once.
+// With a non-empty dumpDir the HSL result is also written there for debugging.
+// GrayWorld/VonKries white balance is estimated from the HSL result and folded
+// into the CCM; Lab runs as a separate stage after gamma.
+bool processImages(const std::string& inputDir, const std::string& outputDir, const std::string& cmcFile,
+                   double hue, double saturation, double lightness, double alpha, double gamma,
+                   const std::string& dumpDir, WhiteBalanceMode wbMode, const BatchOptions& options) {
+    CCM_TRACE_SCOPE("processImages");
+    CcmModel model;   // linear for the legacy 3-row CSV
+    if (!readCcmModel(cmcFile, model))
+        return false;
+
+    BatchSummary summary = runImageBatch(collectImages(inputDir, outputDir),
+        [&](const cv::Mat& img, cv::Mat& corrected, const BatchItem& item) {
+            adjust_hsl_yellow_frame(img, corrected, hue, saturation, lightness);
+            if (!dumpDir.empty()) {
+                CCM_TRACE_SCOPE("dump-intermediate");
+                cv::imwrite(dumpDir + "/" + fs::path(item.input).filename().string(), corrected);
+            }
 
-}
-cv::Mat applyColorCorrection(const cv::Mat& img, const cv::Mat& ColorMatrix) {
-    cv::Mat Dst = img.clone();
-    int channels = img.channels();
-    int ImgHeight = img.rows, ImgWidth = img.cols;
-
-    const float *CMC_1 = ColorMatrix.ptr<float>(0);
-    const float *CMC_2 = ColorMatrix.ptr<float>(1);
-    const float *CMC_3 = ColorMatrix.ptr<float>(2);
-    
-    for (int i = 0; i < ImgHeight; ++i) {
-        const uchar *SP = img.ptr<uchar>(i);
-        uchar *DP = Dst.ptr<uchar>(i);
-        for (int j = 0; j < ImgWidth*channels; j += 3) {
-            DP[j] = cv::saturate_cast<uchar>(SP[j] * CMC_1[0] + SP[j + 1] * CMC_2[0] + SP[j+2] * CMC_3[0]);
-            DP[j+1] = cv::saturate_cast<uchar>(SP[j] * CMC_1[1] + SP[j + 1] * CMC_2[1] + SP[j+2] * CMC_3[1]);
-            DP[j+2] = cv::saturate_cast<uchar>(SP[j] * CMC_1[2] + SP[j + 1] * CMC_2[2] + SP[j+2] * CMC_3[2]);
-        }
-    }
-    double alpha = 0.95; // Điều chỉnh giá trị này để thay đổi độ sáng (< 1.0 để giảm, > 1.0 để tăng)
-    Dst.convertTo(Dst, -1, alpha, 0);
-    return Dst;
-}
+            if (wbMode == WhiteBalanceMode::GrayWorld || wbMode == WhiteBalanceMode::VonKries) {
+                const cv::Matx33f W = whiteBalanceMatrix(wbMode, estimateIlluminant(corrected, model));
+                applyColorCorrection(corrected, corrected, foldWhiteBalance(model, W), alpha);
+            } else {
+                applyColorCorrection(corrected, corrected, model, alpha);
+            }
 
-cv::Mat readColorCorrectionMatrix(const std::string& filename) {
-    std::fstream CMC(filename, std::ios::in);
-    
-    if (!CMC) {
-        std::cerr << "Error opening the file: " << filename << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    
-    cv::Mat ColorMatrix(3, 3, CV_32FC1, cv::Scalar(0));
-    
-    std::string textline;
-    int i = 0;
-    while (getline(CMC, textline)) {
-        std::string::size_type pos = 0, prev_pos = 0;
-        float *CMCPtr = ColorMatrix.ptr<float>(i);
-        int j = 0;
-        while ((pos = textline.find_first_of(',', pos)) != std::string::npos) {
-            CMCPtr[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-            prev_pos = ++pos;
-        }
-        i++;
-    }
-    CMC.close();
-    
-    return ColorMatrix;
+            // You can add more processing steps here if needed
+            // For example:
+            // unsharpMask(corrected, corrected, 0.5);
+            gammaCorrection(corrected, corrected, gamma);
+            if (wbMode == WhiteBalanceMode::Lab)
+                adjustWhiteBalance(corrected, corrected);
+            // bilateralFilter(corrected, corrected, 9, 75, 75);
+            return true;
+        }, options);
+    printBatchSummary(std::cout, summary);
+    return true;
 }
 
-cv::Mat unsharpMask(const cv::Mat& input, float amount) {
-    cv::Mat blurred;
-    cv::GaussianBlur(input, blurred, cv::Size(0, 0), 3);
-    cv::Mat sharpened = input * (1 + amount) + blurred * (-amount);
-    return sharpened;
-}
-cv::Mat gammaCorrection(const cv::Mat& input, float gamma) {
-    cv::Mat lookUpTable(1, 256, CV_8U);
-    uchar* p = lookUpTable.ptr();
-    for(int i = 0; i < 256; ++i)
-        p[i] = cv::saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
-    
-    cv::Mat output;
-    cv::LUT(input, lookUpTable, output);
-    return output;
+// LUT path: every pointwise stage is already baked into the LUT, so each image is
+// decoded once, goes through one memory-bound pass plus white balance, and is encoded once.
+// The LUT is shared by every image, so per-image white balance stays a Lab stage.
+void processImagesLut(const std::string& inputDir, const std::string& outputDir, const Lut3D& lut,
+                      bool whiteBalance, const BatchOptions& options) {
+    CCM_TRACE_SCOPE("processImagesLut");
+    BatchSummary summary = runImageBatch(collectImages(inputDir, outputDir),
+        [&](const cv::Mat& img, cv::Mat& corrected, const BatchItem&) {
+            applyLut3D(img, corrected, lut);
+            if (whiteBalance)
+                adjustWhiteBalance(corrected, corrected);
+            return true;
+        }, options);
+    printBatchSummary(std::cout, summary);
 }
-cv::Mat adjustWhiteBalance(const cv::Mat &img) {
-    cv::Mat result;
-    cv::Mat lab;
-    cv::cvtColor(img, lab, cv::COLOR_BGR2Lab);
 
-    std::vector<cv::Mat> lab_channels(3);
-    cv::split(lab, lab_channels);
-
-    double mean_l = cv::mean(lab_channels[0])[0];
-    double mean_a = cv::mean(lab_channels[1])[0];
-    double mean_b = cv::mean(lab_channels[2])[0];
-
-    lab_channels[1] -= (mean_a - 129);
-    lab_channels[2] -= (mean_b - 129);
-
-    cv::merge(lab_channels, lab);
-    cv::cvtColor(lab, result, cv::COLOR_Lab2BGR);
-    return result;
-}
-cv::Mat bilateralFilter(const cv::Mat& input, int d, double sigmaColor, double sigmaSpace) {
-    cv::Mat output;
-    cv::bilateralFilter(input, output, d, sigmaColor, sigmaSpace);
-    return output;
-}
-void processImages(const std::string& inputDir, const std::string& outputDir, const std::string& cmcFile) {
-    cv::Mat ColorMatrix = readColorCorrectionMatrix(cmcFile);
-
-    for (const auto & entry : fs::directory_iterator(inputDir)) {
-        if (entry.path().extension() == ".jpg" || entry.path().extension() == ".png") {
-            std::cout << "Processing: " << entry.path() << std::endl;
-            
-            cv::Mat img = cv::imread(entry.path().string());
-            if (img.empty()) {
-                std::cerr << "Cannot read image: " << entry.path() << std::endl;
-                continue;
-            }
+// A strip chain split where a folded white balance goes: pre -> CCM -> post.
+// The LUT path bakes everything into pre and has no model.
+struct StripChain {
+    StripFn pre;
+    const CcmModel* model = nullptr;
+    double alpha = 1.0;
+    StripFn post;
+};
 
-            cv::Mat corrected = applyColorCorrection(img, ColorMatrix);
-            
-            // You can add more processing steps here if needed
-            // For example:
-            // corrected = unsharpMask(corrected, 0.5);
-            corrected = gammaCorrection(corrected, 1.2);
-            corrected = adjustWhiteBalance(corrected);
-            // corrected = bilateralFilter(corrected, 9, 75, 75);
-
-            std::string outputPath = outputDir + "/" + entry.path().filename().string();
-            cv::imwrite(outputPath, corrected);
-            std::cout << "Saved: " << outputPath << std::endl;
+// Strip path for very large PPM images (panoramas, orthomosaic tiles): each image
+// is streamed through the chain a strip at a time, so peak memory follows the budget
+// instead of the image size. White balance needs an image-wide mean, so a first pass
+// over every 8th row measures it and the second applies it: the Lab a/b means of the
+// result for Lab, the mean CCM output (folded into the model, as processImages does)
+// for GrayWorld/VonKries. Those two need chain.model.
+bool processImagesStrips(const std::string& inputDir, const std::string& outputDir, const StripChain& chain,
+                         WhiteBalanceMode wbMode, const StripOptions& options) {
+    CCM_TRACE_SCOPE("processImagesStrips");
+    const bool fold = wbMode == WhiteBalanceMode::GrayWorld || wbMode == WhiteBalanceMode::VonKries;
+    CV_Assert(!fold || chain.model);
+    Counter& processed = metrics().counter("ccm_images_processed_total", "Images written successfully");
+    Counter& failed = metrics().counter("ccm_images_failed_total", "Images that could not be read, processed or written");
+    size_t failures = 0;
+    for (const BatchItem& item : collectImages(inputDir, outputDir, {".ppm", ".pnm"})) {
+        CCM_TRACE_SCOPE("image");
+        bool ok = true;
+        CcmModel model = chain.model ? *chain.model : CcmModel();
+        if (fold) {
+            cv::Scalar mean;
+            ok = sampleStripMean(item.input, [&](const cv::Mat& src, cv::Mat& dst) {
+                chain.pre(src, dst);
+                applyColorCorrection(dst, dst, model, 1.0);
+            }, 8, mean, options);
+            const cv::Vec3f illuminant(float(mean[0]), float(mean[1]), float(mean[2]));
+            model = foldWhiteBalance(model, whiteBalanceMatrix(wbMode, illuminant));
+        }
+        const StripFn run = [&](const cv::Mat& src, cv::Mat& dst) {
+            chain.pre(src, dst);
+            if (chain.model)
+                applyColorCorrection(dst, dst, model, chain.alpha);
+            if (chain.post)
+                chain.post(dst, dst);
+        };
+
+        if (wbMode == WhiteBalanceMode::Lab) {
+            cv::Scalar labMean;
+            ok = sampleStripMean(item.input, [&](const cv::Mat& src, cv::Mat& dst) {
+                run(src, dst);
+                cv::cvtColor(dst, dst, cv::COLOR_BGR2Lab);
+            }, 8, labMean, options);
+            const cv::Scalar labShift = whiteBalanceShift(labMean);
+            ok = ok && processPpmStrips(item.input, item.output, [&](const cv::Mat& src, cv::Mat& dst) {
+                run(src, dst);
+                adjustWhiteBalance(dst, dst, labShift);
+            }, options);
+        } else {
+            ok = ok && processPpmStrips(item.input, item.output, run, options);
+        }
+        if (ok) {
+            processed.add();
+            countFileBytes(item.input, item.output);
+            std::cout << "Processed: " << item.input << std::endl;
+        } else {
+            failed.add();
+            failures++;
+            std::cerr << "Failed: " << item.input << std::endl;
         }
     }
+    return failures == 0;
 }
 
-
-int main() {
+int main(int argc, const char * argv[]) {
     auto start = std::chrono::high_resolution_clock::now();
+    // CCM_METRICS_FILE=<path>|- : periodic Prometheus file / stdout line protocol
+    auto metricsFlusher = MetricsFlusher::fromEnvironment();
 
-    // std::string inputDir = "result_hsl";
+    std::string inputDir = "data";
     std::string outputDir = "results";
     std::string cmcFile = "ref/LCC_CMC.csv";
 
-    std::string input_folder_hsl = "data";
-    std::string output_folder_hsl = "result_hsl";
-
-    fs::create_directories(output_folder_hsl);
-
-        // Duyệt qua tất cả các tệp trong thư mục đầu vào
-    for (const auto & entry : fs::directory_iterator(input_folder_hsl)) {
-        if (entry.is_regular_file()) {
-            std::string input_path = entry.path().string();
-            std::string file_name = entry.path().filename().string();
-            std::string output_path = output_folder_hsl + "/" + file_name;
-
-            std::cout << "Processing: " << file_name << std::endl;
-
-            // Áp dụng điều chỉnh HSL cho mỗi ảnh
-            adjust_hsl(input_path, output_path, 0, -40, 30);
-            // Áp dụng điều chỉnh HSL cho anh vach ke duong
-            // adjust_hsl(input_path, output_path, 0, -70, 30);
+    // --ccm <file>      calibration to apply (default ref/LCC_CMC.csv; --auto --model
+    //                   <name> in main saves non-linear fits as ref/LCC_CMC_<name>.csv)
+    // --lut [size]      bake the whole pointwise chain into a size^3 LUT (default 33)
+    // --cube-in <file>  use a graded look from a .cube file instead of baking
+    // --cube-out <file> export the baked LUT
+    // --jobs <n>        images processed concurrently (default: one per core)
+    // --dump-intermediate [dir]  also save the HSL-only result (default result_hsl)
+    // --strip-budget <MB>  stream .ppm inputs in row strips within this much memory
+    // --wb lab|grayworld|vonkries|none  white balance (default lab; grayworld and
+    //                   vonkries are folded into the per-image CCM, so they cannot be
+    //                   combined with --lut / --cube-in)
+    // --preset <name> [--presets file]  scene preset from ref/presets.yml instead of
+    //                   the built-in am vang values; baked LUTs are cached in cache/presets
+    BatchOptions batchOptions;
+    std::string presetsFile = "ref/presets.yml", presetName;
+    WhiteBalanceMode wbMode = WhiteBalanceMode::Lab;
+    StripOptions stripOptions;
+    bool strips = false;
+    std::string dumpDir;
+    int lutSize = 0;
+    std::string cubeIn, cubeOut;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--lut") {
+            lutSize = 33;
+            if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                lutSize = std::stoi(argv[++i]);
+            if (lutSize < 2 || lutSize > 256) {
+                std::cerr << "Invalid LUT size: " << lutSize << " (use --lut [size], 2 to 256)" << std::endl;
+                return -1;
+            }
+        } else if (arg == "--ccm" && i + 1 < argc) {
+            cmcFile = argv[++i];
+        } else if (arg == "--cube-in" && i + 1 < argc) {
+            cubeIn = argv[++i];
+        } else if (arg == "--cube-out" && i + 1 < argc) {
+            cubeOut = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            batchOptions.concurrency = std::stoi(argv[++i]);
+        } else if (arg == "--strip-budget" && i + 1 < argc) {
+            stripOptions.memoryBudget = std::stoul(argv[++i]) << 20;
+            strips = true;
+        } else if (arg == "--wb" && i + 1 < argc) {
+            if (!parseWhiteBalanceMode(argv[++i], wbMode)) {
+                std::cerr << "Unknown white balance mode: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--preset" && i + 1 < argc) {
+            presetName = argv[++i];
+        } else if (arg == "--presets" && i + 1 < argc) {
+            presetsFile = argv[++i];
+        } else if (arg == "--dump-intermediate") {
+            dumpDir = "result_hsl";
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                dumpDir = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
 
+    // Áp dụng điều chỉnh HSL cho mỗi ảnh (am vang unless a preset is given)
+    ScenePreset preset;
+    preset.name = "default";
+    preset.bands = {HueBand{0, 360, 0, 0, -40, 30}};
+    if (!presetName.empty() && !loadPreset(presetsFile, presetName, preset))
+        return -1;
+    const HueBand hsl = preset.primary();
+
+    if (lutSize > 0 || !cubeIn.empty()) {
+        if (wbMode == WhiteBalanceMode::GrayWorld || wbMode == WhiteBalanceMode::VonKries) {
+            std::cerr << "--wb " << whiteBalanceModeName(wbMode)
+                      << " is folded into the per-image CCM; use lab or none with a LUT" << std::endl;
+            return -1;
         }
+        Lut3D lut;
+        if (!cubeIn.empty()) {
+            if (!readCubeFile(cubeIn, lut))
+                return -1;
+        } else {
+            CcmModel model;
+            if (!readCcmModel(cmcFile, model))
+                return -1;
+            lut = cachedLut("cache/presets", preset.name, presetLutKey(preset, model, lutSize), [&] {
+                return buildPipelineLut(hsl.hue, hsl.saturation, hsl.lightness, model, preset.alpha,
+                                        static_cast<float>(preset.gamma), lutSize);
+            });
+            if (lut.empty())
+                return -1;
+        }
+        if (!cubeOut.empty() && writeCubeFile(cubeOut, lut, "color_correction"))
+            std::cout << "LUT saved at: " << cubeOut << std::endl;
+
+        fs::create_directories(outputDir);
+        if (strips) {
+            StripChain chain;
+            chain.pre = [&](const cv::Mat& src, cv::Mat& dst) { applyLut3D(src, dst, lut); };
+            processImagesStrips(inputDir, outputDir, chain, wbMode, stripOptions);
+        } else {
+            processImagesLut(inputDir, outputDir, lut, wbMode != WhiteBalanceMode::None, batchOptions);
+        }
+        std::cout << "All images processed." << std::endl;
+
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Processing time: " << duration.count() << " milliseconds" << std::endl;
+        return 0;
     }
 
-    processImages(output_folder_hsl, outputDir, cmcFile);
+    if (!dumpDir.empty())
+        fs::create_directories(dumpDir);
+    fs::create_directories(outputDir);
+
+    if (strips) {
+        CcmModel model;
+        if (!readCcmModel(cmcFile, model))
+            return -1;
+        StripChain chain;
+        chain.pre = [&](const cv::Mat& src, cv::Mat& dst) {
+            adjust_hsl_yellow_frame(src, dst, hsl.hue, hsl.saturation, hsl.lightness);
+        };
+        chain.model = &model;
+        chain.alpha = preset.alpha;
+        chain.post = [&](const cv::Mat& src, cv::Mat& dst) { gammaCorrection(src, dst, preset.gamma); };
+        if (!processImagesStrips(inputDir, outputDir, chain, wbMode, stripOptions))
+            return -1;
+    } else {
+        // Other scenes: --preset vach_ke_duong, anh_nguoc_nang, ... (ref/presets.yml)
+        if (!processImages(inputDir, outputDir, cmcFile, hsl.hue, hsl.saturation, hsl.lightness,
+                           preset.alpha, preset.gamma, dumpDir, wbMode, batchOptions))
+            return -1;
+    }
 
     std::cout << "All images processed." << std::endl;
 
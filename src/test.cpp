@@ -5,6 +5,11 @@
 #include <fstream>
 #include <vector>
 
+#include "mylib/ccm_kernel.hpp"
+#include "mylib/ccm_store.hpp"
+#include "mylib/chart_detect.hpp"
+#include "mylib/white_balance.hpp"
+
 using namespace std;
 
 cv::Mat unsharpMask(const cv::Mat& input, float amount) {
@@ -51,7 +56,75 @@ cv::Mat bilateralFilter(const cv::Mat& input, int d, double sigmaColor, double s
     return output;
 }
 
-int main() {
+// Chart detector check: imgs/original_img.bmp and its 90/180/270 degree rotations
+// must all give the 24 patches in ReferenceColor.csv order (each centre where the
+// unrotated detection's centre lands after the rotation) with the residual under
+// the gate. A wrong orientation pick moves the centres by whole patches.
+int checkChartDetection() {
+    cv::Mat img = cv::imread("imgs/original_img.bmp");
+    cv::Mat ReferenceColor;
+    if (img.empty() || !readReferenceColors("ref/ReferenceColor.csv", ReferenceColor)) {
+        std::cerr << "Cannot read imgs/original_img.bmp or ref/ReferenceColor.csv" << std::endl;
+        return 1;
+    }
+    const ChartDetectorOptions options;
+    const ChartDetection base = detectColorChart(img, ReferenceColor, options);
+    if (!base.found) {
+        std::cerr << "FAIL 0 deg: chart not found (residual " << base.residual << ")" << std::endl;
+        return 1;
+    }
+    const float pitch = static_cast<float>(cv::norm(base.centers[1] - base.centers[0]));
+    const float W = static_cast<float>(img.cols - 1), H = static_cast<float>(img.rows - 1);
+
+    int failures = 0;
+    const int rotations[] = {-1, cv::ROTATE_90_CLOCKWISE, cv::ROTATE_180, cv::ROTATE_90_COUNTERCLOCKWISE};
+    for (int r = 0; r < 4; r++) {
+        cv::Mat rotated = img;
+        if (rotations[r] >= 0)
+            cv::rotate(img, rotated, rotations[r]);
+        const ChartDetection d = detectColorChart(rotated, ReferenceColor, options);
+        std::string error;
+        if (!d.found) {
+            error = "chart not found";
+        } else if (d.residual >= options.maxResidual) {
+            error = "residual over the gate";
+        } else {
+            for (int i = 0; i < 24 && error.empty(); i++) {
+                const cv::Point2f p = base.centers[i];
+                cv::Point2f expected = p;
+                if (r == 1) expected = cv::Point2f(H - p.y, p.x);
+                if (r == 2) expected = cv::Point2f(W - p.x, H - p.y);
+                if (r == 3) expected = cv::Point2f(p.y, W - p.x);
+                if (cv::norm(d.centers[i] - expected) > 0.25 * pitch)
+                    error = "patch " + std::to_string(i + 1) + " out of order";
+            }
+        }
+        std::cout << (error.empty() ? "ok   " : "FAIL ") << r * 90 << " deg: " << d.patchesSeen
+                  << "/24 seen, residual " << d.residual << (error.empty() ? "" : ", " + error) << std::endl;
+        failures += !error.empty();
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, const char * argv[]) {
+    // --wb lab|grayworld|vonkries|none  white balance (default none, as before)
+    // --check-chart     run the chart detector check and exit (0 = pass)
+    WhiteBalanceMode wbMode = WhiteBalanceMode::None;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--check-chart") {
+            return checkChartDetection();
+        } else if (arg == "--wb" && i + 1 < argc) {
+            if (!parseWhiteBalanceMode(argv[++i], wbMode)) {
+                std::cerr << "Unknown white balance mode: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+
     cv::Mat Dst;
     // Đọc ảnh mới cần hiệu chỉnh
     cv::Mat img = cv::imread("data/output1.jpg");
@@ -60,56 +133,22 @@ int main() {
         return -1;
     }
 
-    int i = 0, j = 0;
-    int channels = img.channels();
-    int ImgHeight = img.rows, ImgWidth = img.cols;
     // Đọc CCM từ file
-    std::fstream CMC("ref/LCC_CMC.csv", std::ios::in);
-    
-    if (!CMC)
-    {
-        std::cerr << "Open the file error" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    
-    cv::Mat ColorMatrix(3, 3, CV_32FC1, cv::Scalar(0));
-    
-    std::string textline;
-    while (getline(CMC, textline))
-    {
-        std::string::size_type pos = 0, prev_pos = 0;
-        float *CMCPtr = ColorMatrix.ptr<float>(i);
-        j = 0;
-        while ((pos = textline.find_first_of(',', pos)) != std::string::npos)
-        {
-            CMCPtr[j++] = std::stof(textline.substr(prev_pos, pos - prev_pos));
-            prev_pos = ++pos;
-        }
-        i++;
-    }
-    CMC.close();
-    
-    Dst = img.clone();
-    
-    float *CMC_1 = ColorMatrix.ptr<float>(0);
-    float *CMC_2 = ColorMatrix.ptr<float>(1);
-    float *CMC_3 = ColorMatrix.ptr<float>(2);
-    
-    for (i = 0; i < ImgHeight; ++i)
-    {
-        uchar *SP = img.ptr<uchar>(i);
-        uchar *DP = Dst.ptr<uchar>(i);
-        for (j = 0; j < ImgWidth*channels; j += 3)
-        {
-            // saturate_cast: dam bao gia tri pixel nam trong [0;255]
-            DP[j] = cv::saturate_cast<uchar>(SP[j] * CMC_1[0] + SP[j + 1] * CMC_2[0] + SP[j+2] * CMC_3[0]);
-            DP[j+1] = cv::saturate_cast<uchar>(SP[j] * CMC_1[1] + SP[j + 1] * CMC_2[1] + SP[j+2] * CMC_3[1]);
-            DP[j+2] = cv::saturate_cast<uchar>(SP[j] * CMC_1[2] + SP[j + 1] * CMC_2[2] + SP[j+2] * CMC_3[2]);
-        }
+    cv::Matx33f ColorMatrix;
+    if (!readColorCorrectionMatrix("ref/LCC_CMC.csv", ColorMatrix))
+        return -1;
+
+    // Áp dụng White Balance: GrayWorld/VonKries được gộp vào CCM, Lab là chế độ tham chiếu
+    if (wbMode == WhiteBalanceMode::GrayWorld || wbMode == WhiteBalanceMode::VonKries) {
+        CcmModel model = CcmModel::linear(ColorMatrix);
+        const cv::Matx33f W = whiteBalanceMatrix(wbMode, estimateIlluminant(img, model));
+        ColorMatrix = foldWhiteBalance(model, W).matrix();
     }
-    
-    // Áp dụng White Balance
-    // Dst = adjustWhiteBalance(Dst);
+
+    applyCCM(img, Dst, ColorMatrix);
+
+    if (wbMode == WhiteBalanceMode::Lab)
+        Dst = adjustWhiteBalance(Dst);
     
     // Tăng độ sắc nét
     // float sharpAmount = 0.5; // Điều chỉnh giá trị này để thay đổi mức độ sắc nét